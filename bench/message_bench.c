@@ -0,0 +1,147 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/message.h"
+#include "jrpc/message_pool.h"
+
+#include <jansson.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#define BENCH_TOTAL_BYTES (256 * 1024 * 1024)
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (((uint64_t) now.tv_sec) * 1000 * 1000 * 1000) + ((uint64_t) now.tv_nsec);
+}
+
+static json_t * bench_create_response(
+    size_t count)
+{
+    json_t * result = json_array();
+    for(size_t i = 0; i < count; i++)
+    {
+        json_t * item = json_object();
+        json_object_set_new(item, "id", json_integer((json_int_t) i));
+        json_object_set_new(item, "name", json_string("some item name"));
+        json_object_set_new(item, "value", json_real(i * 0.5));
+        json_array_append_new(result, item);
+    }
+
+    json_t * response = json_object();
+    json_object_set_new(response, "result", result);
+    json_object_set_new(response, "id", json_integer(42));
+
+    return response;
+}
+
+// previous implementation: measure first, then serialize into an exact allocation;
+// the allocation is taken from the same pool, so only serialization is compared
+static size_t bench_measure_then_dump(
+    struct jrpc_message_pool * pool,
+    json_t * value)
+{
+    size_t const length = json_dumpb(value, NULL, 0, JSON_COMPACT);
+    struct jrpc_message * message = jrpc_message_pool_acquire(pool, length);
+    if (NULL == message)
+    {
+        return 0;
+    }
+
+    message->length = json_dumpb(value, message->data, length, JSON_COMPACT);
+    jrpc_message_pool_release(pool, message);
+
+    return length;
+}
+
+static size_t bench_single_pass(
+    struct jrpc_message_pool * pool,
+    json_t * value)
+{
+    struct jrpc_message * message = jrpc_message_create(pool, value);
+    if (NULL == message)
+    {
+        return 0;
+    }
+
+    size_t const length = message->length;
+    jrpc_message_dispose(message);
+
+    return length;
+}
+
+int main(void)
+{
+    static size_t const counts[] = { 1, 10, 100, 1000, 10000, 100000 };
+
+    struct jrpc_message_pool pool;
+    jrpc_message_pool_init(&pool);
+
+    printf("%10s %10s %12s %14s %14s %8s\n", "items", "bytes", "iterations", "two-pass ns", "one-pass ns", "speedup");
+    for(size_t i = 0; i < (sizeof(counts) / sizeof(counts[0])); i++)
+    {
+        json_t * response = bench_create_response(counts[i]);
+        size_t const length = bench_single_pass(&pool, response);
+        if (0 == length)
+        {
+            printf("%10zu %10s\n", counts[i], "failed");
+            json_decref(response);
+            continue;
+        }
+
+        size_t const iterations = (BENCH_TOTAL_BYTES / length) + 1;
+
+        size_t checksum = 0;
+        uint64_t start = bench_now_ns();
+        for(size_t n = 0; n < iterations; n++)
+        {
+            checksum += bench_measure_then_dump(&pool, response);
+        }
+        uint64_t const two_pass = (bench_now_ns() - start) / iterations;
+
+        start = bench_now_ns();
+        for(size_t n = 0; n < iterations; n++)
+        {
+            checksum -= bench_single_pass(&pool, response);
+        }
+        uint64_t const one_pass = (bench_now_ns() - start) / iterations;
+
+        printf("%10zu %10zu %12zu %14llu %14llu %7.2fx%s\n", counts[i], length, iterations,
+            (unsigned long long) two_pass, (unsigned long long) one_pass,
+            (0 < one_pass) ? ((double) two_pass) / ((double) one_pass) : 0.0,
+            (0 == checksum) ? "" : " (length mismatch)");
+
+        json_decref(response);
+    }
+
+    jrpc_message_pool_cleanup(&pool);
+    return EXIT_SUCCESS;
+}
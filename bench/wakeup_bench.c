@@ -0,0 +1,216 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/loop.h"
+#include "jrpc/post.h"
+#include "jrpc/protocol.h"
+
+#include <poll.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define BENCH_POSTS_PER_PRODUCER (200 * 1000)
+#define BENCH_PING_PONG_POSTS (20 * 1000)
+
+struct bench_run
+{
+    struct jrpc_loop loop;
+    int fd[2];
+    bool use_socketpair;
+    bool is_ping_pong;
+    size_t posts_per_producer;
+    atomic_size_t received;
+    uint64_t latency_sum;
+    uint64_t latency_max;
+};
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (((uint64_t) now.tv_sec) * 1000 * 1000 * 1000) + ((uint64_t) now.tv_nsec);
+}
+
+static struct bench_run * bench_current_run = NULL;
+
+static void bench_ondone(
+    struct jrpc_server * server,
+    void * user_data)
+{
+    (void) server;
+    struct bench_run * run = bench_current_run;
+    uint64_t const latency = bench_now_ns() - (uint64_t) (uintptr_t) user_data;
+
+    atomic_fetch_add(&run->received, 1);
+    run->latency_sum += latency;
+    if (latency > run->latency_max)
+    {
+        run->latency_max = latency;
+    }
+}
+
+static void * bench_produce(
+    void * arg)
+{
+    struct bench_run * run = arg;
+
+    for(size_t i = 0; i < run->posts_per_producer; i++)
+    {
+        struct jrpc_post * post = jrpc_post_create(JRPC_POST_CALL, 0, NULL, NULL);
+        if (NULL == post)
+        {
+            abort();
+        }
+
+        post->done = &bench_ondone;
+        post->user_data = (void *) (uintptr_t) bench_now_ns();
+
+        if (run->use_socketpair)
+        {
+            // previous implementation: one datagram per wakeup
+            char value = 42;
+            jrpc_mpsc_queue_push(&run->loop.posts, &post->node);
+            if (1 != write(run->fd[1], &value, 1))
+            {
+                abort();
+            }
+        }
+        else
+        {
+            jrpc_loop_post(&run->loop, post);
+        }
+
+        // measures the latency of a single wakeup, not of a queue
+        while ((run->is_ping_pong) && (atomic_load(&run->received) <= i))
+        {
+        }
+    }
+
+    return NULL;
+}
+
+static void bench_consume(
+    struct bench_run * run)
+{
+    if (run->use_socketpair)
+    {
+        char value;
+        if (1 == read(run->fd[0], &value, 1)) /* Flawfinder: ignore */
+        {
+            struct jrpc_mpsc_node * node = jrpc_mpsc_queue_pop(&run->loop.posts);
+            while (NULL != node)
+            {
+                jrpc_post_execute((struct jrpc_post *) node, &run->loop);
+                node = jrpc_mpsc_queue_pop(&run->loop.posts);
+            }
+        }
+    }
+    else
+    {
+        jrpc_loop_process_posts(&run->loop);
+    }
+}
+
+static void bench_run(
+    bool use_socketpair,
+    bool is_ping_pong,
+    size_t producer_count)
+{
+    static struct jrpc_protocol protocol;
+    struct bench_run run;
+    jrpc_loop_init(&run.loop, &protocol, 0);
+    run.use_socketpair = use_socketpair;
+    run.is_ping_pong = is_ping_pong;
+    run.posts_per_producer = (is_ping_pong) ? BENCH_PING_PONG_POSTS : BENCH_POSTS_PER_PRODUCER;
+    atomic_init(&run.received, 0);
+    run.latency_sum = 0;
+    run.latency_max = 0;
+    if (0 != socketpair(AF_UNIX, SOCK_DGRAM, 0, run.fd))
+    {
+        abort();
+    }
+    bench_current_run = &run;
+
+    size_t const total = producer_count * run.posts_per_producer;
+    pthread_t producers[producer_count];
+    uint64_t const start = bench_now_ns();
+    for(size_t i = 0; i < producer_count; i++)
+    {
+        pthread_create(&producers[i], NULL, &bench_produce, &run);
+    }
+
+    struct pollfd pollfd;
+    pollfd.fd = (use_socketpair) ? run.fd[0] : run.loop.wakeup_fd;
+    pollfd.events = POLLIN;
+    size_t turns = 0;
+    while (atomic_load(&run.received) < total)
+    {
+        if (0 < poll(&pollfd, 1, 1000))
+        {
+            turns++;
+            bench_consume(&run);
+        }
+    }
+    uint64_t const duration = bench_now_ns() - start;
+
+    for(size_t i = 0; i < producer_count; i++)
+    {
+        pthread_join(producers[i], NULL);
+    }
+
+    printf("%-10s %-10s %9zu %12.0f %10zu %14llu %14llu\n", (use_socketpair) ? "socketpair" : "eventfd",
+        (is_ping_pong) ? "ping-pong" : "burst", producer_count,
+        ((double) total) / (((double) duration) / 1e9), turns,
+        (unsigned long long) (run.latency_sum / total), (unsigned long long) run.latency_max);
+
+    close(run.fd[0]);
+    close(run.fd[1]);
+    jrpc_loop_cleanup(&run.loop);
+}
+
+int main(void)
+{
+    static size_t const producer_counts[] = { 1, 2, 4, 8 };
+
+    printf("%-10s %-10s %9s %12s %10s %14s %14s\n", "wakeup", "mode", "producers", "posts/s", "loop turns", "avg latency ns", "max latency ns");
+    bench_run(true, true, 1);
+    bench_run(false, true, 1);
+
+    for(size_t i = 0; i < (sizeof(producer_counts) / sizeof(producer_counts[0])); i++)
+    {
+        bench_run(true, false, producer_counts[i]);
+        bench_run(false, false, producer_counts[i]);
+    }
+
+    return EXIT_SUCCESS;
+}
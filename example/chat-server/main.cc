@@ -24,7 +24,7 @@
  */
 
 #include <iostream>
-#include <unordered_map>
+#include <string>
 
 #include <cstdlib>
 #include <cstring>
@@ -45,37 +45,48 @@ struct chatter
 };
 
 static volatile bool is_shutdown_requested;
-static std::unordered_map<jrpc_connection *, chatter> chatters;
 
-bool is_name_used(char const * name)
+struct name_query
 {
-    for(const auto& item: chatters)
+    char const * name;
+    bool is_used;
+};
+
+bool check_name(
+    jrpc_connection * connection,
+    void * user_data)
+{
+    name_query & query = *static_cast<name_query *>(user_data);
+    chatter const * actual = static_cast<chatter const *>(jrpc_connection_get_userdata(connection));
+    if ((nullptr != actual) && (0 == actual->name.compare(query.name)))
     {
-        chatter const & actual = item.second;        
-        if (0 == actual.name.compare(name))
-        {
-            return true;
-        }
+        query.is_used = true;
     }
 
-    return false;
+    return !query.is_used;
+}
+
+bool is_name_used(
+    jrpc_server * server,
+    char const * name)
+{
+    name_query query = {name, false};
+    jrpc_server_foreach_connection(server, &check_name, &query);
+
+    return query.is_used;
 }
 
 void announce(
+    jrpc_server * server,
     char const * what,
     char const * who
 )
 {
-    for(auto const & item: chatters) 
-    {
-        chatter const & actual = item.second;
-
-        json_t * params = json_array();
-        json_array_append_new(params, json_string(what));
-        json_array_append_new(params, json_string(who));
+    json_t * params = json_array();
+    json_array_append_new(params, json_string(what));
+    json_array_append_new(params, json_string(who));
 
-        jrpc_notify(actual.connection, "announce", params);
-    }
+    jrpc_notify_all(server, "announce", params);
 }
 
 
@@ -88,7 +99,7 @@ void set_name(
     if ((nullptr != name_holder) && (json_is_string(name_holder))) 
     {
         char const * name = json_string_value(name_holder);
-        if (!is_name_used(name))
+        if (!is_name_used(jrpc_connection_get_server(who.connection), name))
         {
             who.name = name;
 
@@ -96,7 +107,7 @@ void set_name(
             json_object_set_new(result, "name", json_string(name));
             jrpc_respond(who.connection, result, id);
 
-            announce("arrived", who.name.c_str());
+            announce(jrpc_connection_get_server(who.connection), "arrived", who.name.c_str());
         }
         else
         {
@@ -110,24 +121,18 @@ void set_name(
     
 }
 
-void onmethod(
+void onset_name(
     jrpc_connection * connection,
-    char const * method_name,
     json_t * params,
-    int id)
+    int id,
+    void * user_data)
 {
-    auto it = chatters.find(connection);
-    if (it != chatters.end())
+    (void) user_data;
+
+    chatter * who = static_cast<chatter *>(jrpc_connection_get_userdata(connection));
+    if (nullptr != who)
     {
-        chatter & who = it->second;
-        if (0 == strcmp("set_name", method_name))
-        {
-            set_name(who, params, id);
-        }
-        else
-        {
-            jrpc_respond_error(connection, -1, "not implemented", id);
-        }
+        set_name(*who, params, id);
     }
     else
     {
@@ -145,53 +150,45 @@ void chat(
     {
         char const * message = json_string_value(message_holder);
 
-        for(auto const & item: chatters) 
-        {
-            chatter const & actual = item.second;
-
-            json_t * post = json_array();
-            json_array_append_new(post, json_string(who.name.c_str()));
-            json_array_append_new(post, json_string(message));
+        json_t * post = json_array();
+        json_array_append_new(post, json_string(who.name.c_str()));
+        json_array_append_new(post, json_string(message));
 
-            jrpc_notify(actual.connection, "message", post);
-        }
+        jrpc_notify_all(jrpc_connection_get_server(who.connection), "message", post);
     }
 }
 
-void onnotify(
+void onchat(
     jrpc_connection * connection,
-    char const * method_name,
-    json_t * params
+    json_t * params,
+    void * user_data
 )
 {
-    auto it = chatters.find(connection);
-    if (it != chatters.end())
-    {
-        chatter & who = it->second;
+    (void) user_data;
 
-        if (0 == strcmp("chat", method_name))
-        {
-            chat(who, params);
-        }
+    chatter * who = static_cast<chatter *>(jrpc_connection_get_userdata(connection));
+    if (nullptr != who)
+    {
+        chat(*who, params);
     }
 }
 
 void onconnected(
     jrpc_connection * connection)
 {
-    chatters.insert({connection, {connection, ""}});
+    jrpc_connection_set_userdata(connection, new chatter{connection, ""});
 }
 
 void ondisconnected(
     jrpc_connection * connection)
 {
-    auto it = chatters.find(connection);
-    if (it != chatters.end())
+    chatter * who = static_cast<chatter *>(jrpc_connection_get_userdata(connection));
+    if (nullptr != who)
     {
-        chatter & who = it->second;
-        announce("gone", who.name.c_str());
+        announce(jrpc_connection_get_server(connection), "gone", who->name.c_str());
 
-        chatters.erase(connection);
+        jrpc_connection_set_userdata(connection, nullptr);
+        delete who;
     }
 }
 
@@ -289,8 +286,8 @@ int main(int argc, char * argv[])
     jrpc_server_set_protocolname(server, "jrpc-chat");
     jrpc_server_set_onconnected(server, &onconnected);
     jrpc_server_set_ondisconnected(server, &ondisconnected);
-    jrpc_server_set_onmethod(server, &onmethod);
-    jrpc_server_set_onnotify(server, &onnotify);
+    jrpc_server_register_method(server, "set_name", &onset_name, nullptr);
+    jrpc_server_register_notification(server, "chat", &onchat, nullptr);
 
     int result = parse_arguments(argc, argv, server);
     if (EXIT_SUCCESS == result)
@@ -29,9 +29,67 @@
 #include <jrpc/api.h>
 #include <jansson.h>
 
+#ifndef __cplusplus
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#else
+#include <cstddef>
+#include <cstdint>
+using ::std::size_t;
+#endif
+
 struct jrpc_connection;
 struct jrpc_server;
 
+/// \brief Thread-safe reference to a connection.
+///
+/// A handle stays valid after the connection is closed; it
+/// just no longer refers to any connection. A handle is never
+/// 0.
+///
+/// \see jrpc_connection_get_handle
+typedef uint64_t jrpc_connection_handle;
+
+/// \brief Priority of an outbound message.
+///
+/// Each connection has two outbound lanes. Responses and errors are
+/// always queued in the high priority lane, notifications in the normal
+/// lane unless sent with JRPC_PRIORITY_HIGH. When both lanes hold
+/// messages, the high priority lane is served by weight.
+///
+/// \see jrpc_notify_priority
+/// \see jrpc_server_set_priority_weight
+enum jrpc_priority
+{
+    /// \brief Queued after responses; used by jrpc_notify.
+    JRPC_PRIORITY_NORMAL,
+
+    /// \brief Queued with responses and errors.
+    JRPC_PRIORITY_HIGH
+};
+
+/// \brief Small integer identifier of a connection.
+///
+/// The identifier is unique among open connections of a server and
+/// stays the same while the connection is open. Once the connection is
+/// closed, its identifier may be reused by a new connection.
+///
+/// \see jrpc_connection_get_id
+/// \see jrpc_server_find_connection
+typedef uint32_t jrpc_connection_id;
+
+/// \brief Callback function to visit a connection.
+///
+/// \param connection Connection visited
+/// \param user_data User data specified by jrpc_server_foreach_connection
+/// \return true to continue, false to stop the iteration
+///
+/// \see jrpc_server_foreach_connection
+typedef bool jrpc_connection_visit_fn(
+    struct jrpc_connection * connection,
+    void * user_data);
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -93,6 +151,288 @@ extern JRPC_API void jrpc_notify(
     char const * method,
     json_t * params);
 
+/// \brief Notfies a given connection with a priority hint.
+///
+/// High priority notifications are queued with responses and errors,
+/// so they are not held back by a backlog of normal notifications.
+/// Notifications of the same priority keep their order.
+///
+/// \param connection Connection that will receive the notification
+/// \param method Name of the notification
+/// \param params JSON-array or JSON-object containing the arguments of the notification
+/// \param priority Outbound lane of the notification
+///
+/// \see jrpc_notify
+/// \see jrpc_server_set_priority_weight
+extern JRPC_API void jrpc_notify_priority(
+    struct jrpc_connection * connection,
+    char const * method,
+    json_t * params,
+    enum jrpc_priority priority);
+
+/// \brief Notifies a connection, replacing an unsent notification with the same key.
+///
+/// Intended for high-frequency updates, where only the latest value
+/// matters. If a notification with the same key is still queued for the
+/// connection, it is replaced in place by the new one, keeping its
+/// position in the queue. Otherwise, the notification is queued like
+/// one sent by jrpc_notify.
+///
+/// \param connection Connection that will receive the notification
+/// \param key Conflation key, e.g. the name of the updated item
+/// \param method Name of the notification
+/// \param params JSON-array or JSON-object containing the arguments of the notification
+///
+/// \see jrpc_notify
+/// \see jrpc_connection_get_conflated_messages
+extern JRPC_API void jrpc_notify_conflated(
+    struct jrpc_connection * connection,
+    char const * key,
+    char const * method,
+    json_t * params);
+
+/// \brief Notifies a set of connections.
+///
+/// The notification is serialized only once and shared by all
+/// receiving connections of the calling thread's loop. Connections
+/// of other loops receive a copy through their loop. Handles of
+/// closed connections are skipped.
+///
+/// \note This function can be called safely from a foreign thread.
+///
+/// \param server Instance of the server
+/// \param handles Array of handles of the connections that will receive the notification
+/// \param count Number of handles
+/// \param method Name of the notification
+/// \param params JSON-array or JSON-object containing the arguments of the notification
+///
+/// \see jrpc_notify
+/// \see jrpc_notify_all
+extern JRPC_API void jrpc_notify_many(
+    struct jrpc_server * server,
+    jrpc_connection_handle const * handles,
+    size_t count,
+    char const * method,
+    json_t * params);
+
+/// \brief Notifies all connections of a server.
+///
+/// The notification is serialized only once and shared by
+/// all connections.
+///
+/// \note This function can be called safely from a foreign thread.
+///
+/// \param server Instance of the server
+/// \param method Name of the notification
+/// \param params JSON-array or JSON-object containing the arguments of the notification
+///
+/// \see jrpc_notify
+/// \see jrpc_notify_many
+extern JRPC_API void jrpc_notify_all(
+    struct jrpc_server * server,
+    char const * method,
+    json_t * params);
+
+/// \brief Subscribes a connection to a topic.
+///
+/// Subscribing to a topic twice has no effect. Subscriptions are
+/// removed automatically, when the connection is closed.
+///
+/// \param connection Instance of the connection
+/// \param topic Name of the topic
+/// \return true on success, false if out of memory
+///
+/// \see jrpc_unsubscribe
+/// \see jrpc_publish
+extern JRPC_API bool jrpc_subscribe(
+    struct jrpc_connection * connection,
+    char const * topic);
+
+/// \brief Unsubscribes a connection from a topic.
+///
+/// \param connection Instance of the connection
+/// \param topic Name of the topic
+///
+/// \see jrpc_subscribe
+extern JRPC_API void jrpc_unsubscribe(
+    struct jrpc_connection * connection,
+    char const * topic);
+
+/// \brief Notifies all connections subscribed to a topic.
+///
+/// The notification is serialized only once and shared by all
+/// subscribers. The cost of publishing depends on the number of
+/// subscribers, not on the number of connections.
+///
+/// The notification is sent to the connections subscribed when
+/// publishing starts. Watermark handlers invoked meanwhile may
+/// subscribe or unsubscribe connections; this takes effect with
+/// the next publication.
+///
+/// \note This function can be called safely from a foreign thread.
+///
+/// \param server Instance of the server
+/// \param topic Name of the topic
+/// \param method Name of the notification
+/// \param params JSON-array or JSON-object containing the arguments of the notification
+///
+/// \see jrpc_subscribe
+/// \see jrpc_notify_all
+extern JRPC_API void jrpc_publish(
+    struct jrpc_server * server,
+    char const * topic,
+    char const * method,
+    json_t * params);
+
+/// \brief Returns the thread-safe handle of a connection.
+///
+/// \param connection Instance of the connection
+/// \return Handle of the connection
+///
+/// \see jrpc_respond_threadsafe
+/// \see jrpc_respond_error_threadsafe
+/// \see jrpc_notify_threadsafe
+extern JRPC_API jrpc_connection_handle jrpc_connection_get_handle(
+    struct jrpc_connection * connection);
+
+/// \brief Resolves the handle of a connection.
+///
+/// \note This function must be called by the thread servicing the
+///       connection, i.e. the thread invoking its method handlers.
+///
+/// \param server Instance of the server
+/// \param handle Handle of the connection
+/// \return Connection or NULL, if the connection is closed
+///
+/// \see jrpc_connection_get_handle
+extern JRPC_API struct jrpc_connection * jrpc_server_get_connection(
+    struct jrpc_server * server,
+    jrpc_connection_handle handle);
+
+/// \brief Sends a response to a connection from any thread.
+///
+/// The response is handed over to the thread running the server
+/// and sent from there. If the connection is closed in the meantime,
+/// the response is discarded.
+///
+/// \note This function can be called safely from a foreign thread.
+///
+/// \param server Instance of the server
+/// \param handle Handle of the connection that will receive the response
+/// \param result any JSON type, representing the response (ownership is transferred)
+/// \param id ID of the corresponding request
+///
+/// \see jrpc_respond
+extern JRPC_API void jrpc_respond_threadsafe(
+    struct jrpc_server * server,
+    jrpc_connection_handle handle,
+    json_t * result,
+    int id);
+
+/// \brief Sends an error message to a connection from any thread.
+///
+/// \note This function can be called safely from a foreign thread.
+///
+/// \param server Instance of the server
+/// \param handle Handle of the connection that will receive the response
+/// \param error_code User defined error code
+/// \param error_message User definied error message
+/// \param id ID of the corresponding request
+///
+/// \see jrpc_respond_error
+extern JRPC_API void jrpc_respond_error_threadsafe(
+    struct jrpc_server * server,
+    jrpc_connection_handle handle,
+    int error_code,
+    char const * error_message,
+    int id);
+
+/// \brief Notifies a connection from any thread.
+///
+/// \note This function can be called safely from a foreign thread.
+///
+/// \param server Instance of the server
+/// \param handle Handle of the connection that will receive the notification
+/// \param method Name of the notification
+/// \param params JSON-array or JSON-object containing the arguments of the notification
+///
+/// \see jrpc_notify
+extern JRPC_API void jrpc_notify_threadsafe(
+    struct jrpc_server * server,
+    jrpc_connection_handle handle,
+    char const * method,
+    json_t * params);
+
+/// \brief Returns the number of bytes queued for the connection.
+///
+/// \param connection Instance of the connection
+/// \return Number of bytes, that are not sent yet
+extern JRPC_API size_t jrpc_connection_get_outbound_bytes(
+    struct jrpc_connection * connection);
+
+/// \brief Returns the number of messages queued for the connection.
+///
+/// \param connection Instance of the connection
+/// \return Number of messages, that are not sent yet
+extern JRPC_API size_t jrpc_connection_get_outbound_messages(
+    struct jrpc_connection * connection);
+
+/// \brief Returns the number of requests of the connection waiting for a response.
+///
+/// \note Requests are only tracked, if a request timeout is set or
+///       request cancellation is enabled.
+///
+/// \param connection Instance of the connection
+/// \return Number of outstanding requests
+///
+/// \see jrpc_server_set_request_timeout
+extern JRPC_API size_t jrpc_connection_get_pending_requests(
+    struct jrpc_connection * connection);
+
+/// \brief Checks, whether a request was cancelled.
+///
+/// Lets a long-running method poll for cancellation. A request which
+/// timed out is reported as cancelled, too.
+///
+/// \note Must be called from the service thread of the connection.
+///
+/// \param connection Instance of the connection
+/// \param id Id of the request
+/// \return true, if the response to the request will be discarded;
+///         always false if requests are not tracked
+///
+/// \see jrpc_server_set_request_cancellation
+extern JRPC_API bool jrpc_is_cancelled(
+    struct jrpc_connection * connection,
+    int id);
+
+/// \brief Returns the number of messages dropped due to a full outbound queue.
+///
+/// \param connection Instance of the connection
+/// \return Number of dropped messages
+///
+/// \see jrpc_server_set_outbound_limit
+extern JRPC_API size_t jrpc_connection_get_dropped_messages(
+    struct jrpc_connection * connection);
+
+/// \brief Returns the number of queued notifications replaced by newer ones.
+///
+/// \param connection Instance of the connection
+/// \return Number of notifications, that were conflated and never sent
+///
+/// \see jrpc_notify_conflated
+extern JRPC_API size_t jrpc_connection_get_conflated_messages(
+    struct jrpc_connection * connection);
+
+/// \brief Returns, whether the connection's outbound queue is above the high watermark.
+///
+/// \param connection Instance of the connection
+/// \return true, if the connection is congested
+///
+/// \see jrpc_server_set_outbound_watermarks
+extern JRPC_API bool jrpc_connection_is_congested(
+    struct jrpc_connection * connection);
+
 /// \brief Returns the server instance associated with the connection.
 ///
 /// \param connection Instance of the connection
@@ -100,6 +440,56 @@ extern JRPC_API void jrpc_notify(
 extern JRPC_API struct jrpc_server * jrpc_connection_get_server(
     struct jrpc_connection * connection);
 
+/// \brief Returns the identifier of a connection.
+///
+/// \param connection Instance of the connection
+/// \return Identifier of the connection
+///
+/// \see jrpc_server_find_connection
+extern JRPC_API jrpc_connection_id jrpc_connection_get_id(
+    struct jrpc_connection * connection);
+
+/// \brief Looks up an open connection by its identifier.
+///
+/// \note Only connections serviced by the calling thread are found.
+///       Called from any other thread, NULL is returned.
+///
+/// \param server Instance of the server
+/// \param id Identifier of the connection
+/// \return Connection or NULL, if there is no such connection
+///
+/// \see jrpc_connection_get_id
+extern JRPC_API struct jrpc_connection * jrpc_server_find_connection(
+    struct jrpc_server * server,
+    jrpc_connection_id id);
+
+/// \brief Visits all open connections serviced by the calling thread.
+///
+/// The visitor may notify, respond to or close connections. Connections
+/// that are closing, including those closed during the iteration by the
+/// visitor, are skipped. The cost depends on the number of open
+/// connections, not on the highest number ever open.
+///
+/// \param server Instance of the server
+/// \param visit Visitor invoked for each connection
+/// \param user_data User data passed to the visitor
+///
+/// \see jrpc_server_get_connection_count
+extern JRPC_API void jrpc_server_foreach_connection(
+    struct jrpc_server * server,
+    jrpc_connection_visit_fn * visit,
+    void * user_data);
+
+/// \brief Returns the number of open connections of all service threads.
+///
+/// \note With several service threads, the counts of other threads
+///       are read while they change, so the result is approximate.
+///
+/// \param server Instance of the server
+/// \return Number of open connections
+extern JRPC_API size_t jrpc_server_get_connection_count(
+    struct jrpc_server * server);
+
 /// \brief Sets user specific data for the connection.
 ///
 /// User specific data is not used by JRPC but it might be
@@ -29,9 +29,96 @@
 #include <jrpc/api.h>
 #include <jansson.h>
 
+#ifndef __cplusplus
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#else
+#include <cstddef>
+#include <cstdint>
+using ::std::size_t;
+#endif
+
+/// \brief Error code of the error sent, when a request timed out.
+///
+/// \see jrpc_server_set_request_timeout
+#define JRPC_TIMEOUT_ERROR_CODE (-32000)
+
+/// \brief Error code of the error sent, when a request is rejected.
+///
+/// Requests are rejected, if their id is an integer outside the range
+/// of int; the error is sent with id null. While requests are tracked,
+/// a request reusing the id of an outstanding request is rejected, too.
+///
+/// \see jrpc_server_set_request_timeout
+#define JRPC_INVALID_REQUEST_ERROR_CODE (-32600)
+
 struct jrpc_server;
 struct jrpc_connection;
 
+/// \brief Statistics of the server's message pool.
+///
+/// \see jrpc_server_get_message_pool_stats
+struct jrpc_message_pool_stats
+{
+    /// \brief Number of messages served from the pool.
+    size_t hits;
+
+    /// \brief Number of messages that had to be allocated.
+    size_t misses;
+
+    /// \brief Bytes currently held by the pool for reuse.
+    size_t bytes_retained;
+
+    /// \brief Number of messages currently held by the pool for reuse.
+    size_t messages_retained;
+};
+
+/// \brief Statistics of the server's write path.
+///
+/// \see jrpc_server_get_write_stats
+struct jrpc_write_stats
+{
+    /// \brief Number of writeable callbacks that sent messages.
+    size_t writeable_callbacks;
+
+    /// \brief Number of messages sent in total.
+    size_t messages_sent;
+
+    /// \brief Number of bytes sent in total (payload only).
+    size_t bytes_sent;
+
+    /// \brief Highest number of messages sent within a single callback.
+    size_t max_messages_per_callback;
+
+    /// \brief Number of websocket fragments of large messages sent in total.
+    size_t fragments_sent;
+};
+
+/// \brief Statistics of the server's worker pool.
+///
+/// \see jrpc_server_get_worker_pool_stats
+struct jrpc_worker_pool_stats
+{
+    /// \brief Number of running worker threads.
+    size_t threads;
+
+    /// \brief Number of offloaded calls waiting for a worker.
+    size_t queue_depth;
+
+    /// \brief Highest number of offloaded calls waiting for a worker.
+    size_t max_queue_depth;
+
+    /// \brief Number of offloaded calls completed.
+    size_t jobs_completed;
+
+    /// \brief Accumulated time offloaded calls waited for a worker in microseconds.
+    uint64_t total_wait_us;
+
+    /// \brief Longest time an offloaded call waited for a worker in microseconds.
+    uint64_t max_wait_us;
+};
+
 /// \brief Callback function to invoke a method.
 ///
 /// This callback is used as method handler. It will be called, whenever a connection invokes a method.
@@ -39,8 +126,9 @@ struct jrpc_connection;
 /// Both, responses or errors may be reported synchrously within the callback or
 /// asynchronously at any time later.
 ///
-/// \note Since JRPC server is stateless, it will not keep track on method calls.
-/// \note There is also no timeout handling applied by JRPC server.
+/// \note By default, JRPC server will not keep track on method calls.
+/// \note There is also no timeout handling applied by JRPC server,
+///       unless a request timeout is set.
 ///
 /// \param connection Connection, that invokes the method
 /// \param method_name Name of the method to invoke
@@ -72,6 +160,159 @@ typedef void jrpc_notify_fn(
     char const * method_name,
     json_t * params);
 
+/// \brief Callback function to invoke a method with undecoded params.
+///
+/// Variant of jrpc_invoke_fn for handlers that parse params on their own.
+/// Params are provided as a view into the receive buffer, so that no
+/// JSON tree is built and no bytes are copied.
+///
+/// \note The params view is only valid during the callback. Copy it,
+///       if it is needed to respond asynchronously.
+///
+/// \param connection Connection, that invokes the method
+/// \param method_name Name of the method to invoke
+/// \param params JSON text of params (array or object), not NUL-terminated
+/// \param params_length Length of params in bytes
+/// \param id ID of the method call, which must be used in response
+///
+/// \see jrpc_server_set_onmethod_raw
+/// \see jrpc_invoke_fn
+typedef void jrpc_invoke_raw_fn(
+    struct jrpc_connection * connection,
+    char const * method_name,
+    char const * params,
+    size_t params_length,
+    int id);
+
+/// \brief Callback function to notify the server with undecoded params.
+///
+/// Variant of jrpc_notify_fn for handlers that parse params on their own.
+///
+/// \note The params view is only valid during the callback.
+///
+/// \param connection  Connection, that triggers the notification
+/// \param method_name Name of the notification
+/// \param params JSON text of params (array or object), not NUL-terminated
+/// \param params_length Length of params in bytes
+///
+/// \see jrpc_server_set_onnotify_raw
+/// \see jrpc_notify_fn
+typedef void jrpc_notify_raw_fn(
+    struct jrpc_connection * connection,
+    char const * method_name,
+    char const * params,
+    size_t params_length);
+
+/// \brief Callback function of a registered method.
+///
+/// Each method is expected to be answered, either synchronously or
+/// asynchronously, just like methods handled by jrpc_invoke_fn.
+///
+/// \param connection Connection, that invokes the method
+/// \param params JSON-array or JSON-object containing the arguments of the method
+/// \param id ID of the method call, which must be used in response
+/// \param user_data User data specified at registration
+///
+/// \see jrpc_server_register_method
+typedef void jrpc_method_fn(
+    struct jrpc_connection * connection,
+    json_t * params,
+    int id,
+    void * user_data);
+
+/// \brief Callback function of a registered method, that receives undecoded params.
+///
+/// \note The params view is only valid during the callback.
+///
+/// \param connection Connection, that invokes the method
+/// \param params JSON text of params (array or object), not NUL-terminated
+/// \param params_length Length of params in bytes
+/// \param id ID of the method call, which must be used in response
+/// \param user_data User data specified at registration
+///
+/// \see jrpc_server_register_method_raw
+typedef void jrpc_method_raw_fn(
+    struct jrpc_connection * connection,
+    char const * params,
+    size_t params_length,
+    int id,
+    void * user_data);
+
+/// \brief Callback function of a registered notification.
+///
+/// \param connection Connection, that triggers the notification
+/// \param params JSON-array or JSON-object containing the arguments of the notification
+/// \param user_data User data specified at registration
+///
+/// \see jrpc_server_register_notification
+typedef void jrpc_notification_fn(
+    struct jrpc_connection * connection,
+    json_t * params,
+    void * user_data);
+
+/// \brief Callback function of a registered notification, that receives undecoded params.
+///
+/// \note The params view is only valid during the callback.
+///
+/// \param connection Connection, that triggers the notification
+/// \param params JSON text of params (array or object), not NUL-terminated
+/// \param params_length Length of params in bytes
+/// \param user_data User data specified at registration
+///
+/// \see jrpc_server_register_notification_raw
+typedef void jrpc_notification_raw_fn(
+    struct jrpc_connection * connection,
+    char const * params,
+    size_t params_length,
+    void * user_data);
+
+/// \brief Callback function of a method, that is offloaded to the worker pool.
+///
+/// The callback runs on a worker thread. Its result is sent back to
+/// the connection by the thread running the server. If the connection
+/// is closed in the meantime, the result is discarded.
+///
+/// \note The callback must not call any JRPC function other than
+///       those documented as thread-safe.
+///
+/// \param params JSON-array or JSON-object containing the arguments of the method
+/// \param error_code Error code to report, if no result is returned (defaults to -1)
+/// \param error_message Error message to report, if no result is returned;
+///        must remain valid until the callback returns
+/// \param user_data User data specified at registration
+/// \return Result of the method (ownership is transferred) or NULL on error
+///
+/// \see jrpc_server_register_method_offloaded
+typedef json_t * jrpc_offloaded_method_fn(
+    json_t * params,
+    int * error_code,
+    char const * * error_message,
+    void * user_data);
+
+/// \brief Work function run on a worker thread.
+///
+/// \note The function must not call any JRPC function other than
+///       those documented as thread-safe.
+///
+/// \param user_data User data specified by jrpc_server_offload
+///
+/// \see jrpc_server_offload
+typedef void jrpc_work_fn(
+    void * user_data);
+
+/// \brief Callback function invoked once offloaded work is done.
+///
+/// The callback is invoked by the thread servicing the loop, the work
+/// was offloaded from; see jrpc_server_offload for foreign threads.
+///
+/// \param server Instance of the server
+/// \param user_data User data specified by jrpc_server_offload
+///
+/// \see jrpc_server_offload
+typedef void jrpc_work_done_fn(
+    struct jrpc_server * server,
+    void * user_data);
+
 /// \brief Callback function to inform the server about a new connection.
 ///
 /// The callback will be invoked, whenever a new connection is established.
@@ -96,6 +337,113 @@ typedef void jrpc_connected_fn(
 typedef void jrpc_disconnected_fn(
     struct jrpc_connection * connection);
 
+/// \brief Callback function to inform about a connection's outbound queue
+///        crossing a watermark.
+///
+/// The high watermark callback is invoked once the queued bytes of a
+/// connection reach the high watermark. The low watermark callback is
+/// invoked once the queue of such a congested connection drained down to
+/// the low watermark.
+///
+/// \param connection Connection, whose outbound queue crossed the watermark
+///
+/// \see jrpc_server_set_outbound_watermarks
+/// \see jrpc_server_set_onhighwatermark
+/// \see jrpc_server_set_onlowwatermark
+typedef void jrpc_watermark_fn(
+    struct jrpc_connection * connection);
+
+/// \brief Callback function to inform about a cancelled request.
+///
+/// Invoked once per request, either when the client sent a
+/// "$/cancelRequest" notification for it or when the connection closed
+/// while the request was outstanding. Long-running handlers may stop
+/// early; any later response to the request is discarded.
+///
+/// \param connection Connection of the request
+/// \param id Id of the cancelled request
+///
+/// \see jrpc_server_set_request_cancellation
+/// \see jrpc_server_set_oncancel
+/// \see jrpc_is_cancelled
+typedef void jrpc_cancel_fn(
+    struct jrpc_connection * connection,
+    int id);
+
+/// \brief Change of a file descriptor watched by an external event loop.
+///
+/// \see jrpc_poll_fn
+enum jrpc_poll_action
+{
+    /// \brief File descriptor is added and must be watched for the given events.
+    JRPC_POLL_ADD,
+
+    /// \brief Events of an already watched file descriptor changed.
+    JRPC_POLL_MODIFY,
+
+    /// \brief File descriptor is removed and must no longer be watched.
+    JRPC_POLL_REMOVE
+};
+
+/// \brief Callback function to integrate the server into an external event loop.
+///
+/// Informs the external event loop about file descriptors of the server,
+/// that must be watched. Whenever a watched file descriptor becomes ready,
+/// jrpc_server_service_fd must be called.
+///
+/// \param fd File descriptor
+/// \param action Kind of change
+/// \param events Events to watch (POLLIN, POLLOUT as defined by poll.h)
+/// \param user_data User data specified by jrpc_server_set_onpoll
+///
+/// \see jrpc_server_set_onpoll
+typedef void jrpc_poll_fn(
+    int fd,
+    enum jrpc_poll_action action,
+    int events,
+    void * user_data);
+
+/// \brief Identifier of a timer.
+///
+/// The identifier of a fired or cancelled timer never refers to
+/// another timer; 0 is never a valid identifier.
+///
+/// \see jrpc_server_add_timer
+typedef uint64_t jrpc_timer_id;
+
+/// \brief Callback function of a timer.
+///
+/// The callback is invoked by the thread servicing the loop, the timer
+/// was added to, i.e. the same thread invoking the method handlers.
+///
+/// \param server Instance of the server
+/// \param id Identifier of the timer
+/// \param user_data User data specified by jrpc_server_add_timer
+///
+/// \see jrpc_server_add_timer
+typedef void jrpc_timer_fn(
+    struct jrpc_server * server,
+    jrpc_timer_id id,
+    void * user_data);
+
+/// \brief Policy applied when a connection's outbound queue is full.
+///
+/// Responses and errors are never dropped. They are queued even if
+/// this exceeds the limit. The policy is applied to notifications only.
+///
+/// \see jrpc_server_set_outbound_limit
+enum jrpc_overflow_policy
+{
+    /// \brief Drops the oldest queued notifications to make room.
+    JRPC_OVERFLOW_DROP_OLDEST,
+
+    /// \brief Drops the notification that is about to be queued.
+    JRPC_OVERFLOW_DROP_NEWEST,
+
+    /// \brief Closes the connection, when a notification overflows.
+    JRPC_OVERFLOW_CLOSE
+};
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -126,7 +474,8 @@ extern JRPC_API void jrpc_server_set_port(
 
 /// \brief Sets the method handler.
 ///
-/// The method handler will be called, whenever a connection invokes a method.
+/// The method handler will be called, whenever a connection invokes a method,
+/// that is not registered.
 ///
 /// \note If not set, a default handler will be used, that returns a generic error
 ///       to the connection for each method invokation.
@@ -141,7 +490,8 @@ extern JRPC_API void jrpc_server_set_onmethod(
 
 /// \brief Sets the notification handler.
 ///
-/// The notification handler will be called, whenever a connection notifies the server.
+/// The notification handler will be called, whenever a connection notifies the server
+/// with a notification, that is not registered.
 ///
 /// \note If not set, a default handler will be used, which swallows silently each 
 ///       notfication.
@@ -154,6 +504,181 @@ extern JRPC_API void jrpc_server_set_onnotify(
     struct jrpc_server * server,
     jrpc_notify_fn * handler);
 
+/// \brief Sets a method handler, that receives undecoded params.
+///
+/// If set, it replaces the method handler set by jrpc_server_set_onmethod.
+/// Set it to NULL to use jrpc_server_set_onmethod's handler again.
+///
+/// \param server Instance of the server
+/// \param handler Raw method handler or NULL
+///
+/// \see jrpc_invoke_raw_fn
+extern JRPC_API void jrpc_server_set_onmethod_raw(
+    struct jrpc_server * server,
+    jrpc_invoke_raw_fn * handler);
+
+/// \brief Sets a notification handler, that receives undecoded params.
+///
+/// If set, it replaces the notification handler set by jrpc_server_set_onnotify.
+/// Set it to NULL to use jrpc_server_set_onnotify's handler again.
+///
+/// \param server Instance of the server
+/// \param handler Raw notification handler or NULL
+///
+/// \see jrpc_notify_raw_fn
+extern JRPC_API void jrpc_server_set_onnotify_raw(
+    struct jrpc_server * server,
+    jrpc_notify_raw_fn * handler);
+
+/// \brief Registers a method handler.
+///
+/// Registered methods are dispatched by a hashed method table. Methods, that
+/// are not registered, are passed to the handler set by jrpc_server_set_onmethod.
+/// Registering a name again replaces the previous handler.
+///
+/// \note Methods and notifications must be registered before jrpc_server_start
+///       (or the first call of jrpc_server_run). The method table is frozen
+///       into a perfect hash at that time and shared by all service threads;
+///       later registrations are ignored.
+///
+/// \param server Instance of the server
+/// \param method_name Name of the method
+/// \param handler Method handler
+/// \param user_data User data passed to the handler
+///
+/// \see jrpc_method_fn
+extern JRPC_API void jrpc_server_register_method(
+    struct jrpc_server * server,
+    char const * method_name,
+    jrpc_method_fn * handler,
+    void * user_data);
+
+/// \brief Registers a method handler, that receives undecoded params.
+///
+/// \param server Instance of the server
+/// \param method_name Name of the method
+/// \param handler Raw method handler
+/// \param user_data User data passed to the handler
+///
+/// \see jrpc_server_register_method
+/// \see jrpc_method_raw_fn
+extern JRPC_API void jrpc_server_register_method_raw(
+    struct jrpc_server * server,
+    char const * method_name,
+    jrpc_method_raw_fn * handler,
+    void * user_data);
+
+/// \brief Registers a method handler, that runs on the worker pool.
+///
+/// Params are parsed by the thread running the server. The handler is
+/// executed on one of the worker threads, so slow handlers do not stall
+/// other connections.
+///
+/// \note The worker pool is started by the first call of jrpc_server_run,
+///       if at least one offloaded method is registered.
+///
+/// \param server Instance of the server
+/// \param method_name Name of the method
+/// \param handler Offloaded method handler
+/// \param user_data User data passed to the handler
+///
+/// \see jrpc_offloaded_method_fn
+/// \see jrpc_server_set_worker_threads
+extern JRPC_API void jrpc_server_register_method_offloaded(
+    struct jrpc_server * server,
+    char const * method_name,
+    jrpc_offloaded_method_fn * handler,
+    void * user_data);
+
+/// \brief Sets the number of worker threads running offloaded methods.
+///
+/// \note If not set, 4 worker threads are used. At least one thread is used.
+///       Must be set before the first call of jrpc_server_run.
+///       Setting the number of threads also starts the worker pool,
+///       if no offloaded method is registered.
+///
+/// \param server Instance of the server
+/// \param thread_count Number of worker threads
+///
+/// \see jrpc_server_register_method_offloaded
+/// \see jrpc_server_offload
+extern JRPC_API void jrpc_server_set_worker_threads(
+    struct jrpc_server * server,
+    size_t thread_count);
+
+/// \brief Runs work on the worker pool.
+///
+/// The work function is run by a worker thread. Afterwards, the done
+/// callback is invoked by the thread servicing the calling loop. This
+/// allows to await slow work without blocking the loop.
+///
+/// \note This function can be called safely from a foreign thread. In
+///       that case, the done callback is invoked by the thread calling
+///       jrpc_server_run (or servicing the foreign loop).
+///
+/// \note The done callback is not invoked, if the server is disposed
+///       before the work completed.
+///
+/// \param server Instance of the server
+/// \param work Work function
+/// \param done Callback invoked after the work is done
+/// \param user_data User data passed to both functions
+/// \return true, if the work was submitted; false if the worker pool
+///         is not running
+///
+/// \see jrpc_server_set_worker_threads
+extern JRPC_API bool jrpc_server_offload(
+    struct jrpc_server * server,
+    jrpc_work_fn * work,
+    jrpc_work_done_fn * done,
+    void * user_data);
+
+/// \brief Retrieves statistics of the server's worker pool.
+///
+/// Divide total_wait_us by jobs_completed to get the average time
+/// an offloaded call waited for a worker.
+///
+/// \param server Instance of the server
+/// \param stats Pointer to statistics to fill
+///
+/// \see jrpc_server_set_worker_threads
+extern JRPC_API void jrpc_server_get_worker_pool_stats(
+    struct jrpc_server * server,
+    struct jrpc_worker_pool_stats * stats);
+
+/// \brief Registers a notification handler.
+///
+/// Notifications, that are not registered, are passed to the handler
+/// set by jrpc_server_set_onnotify.
+///
+/// \param server Instance of the server
+/// \param method_name Name of the notification
+/// \param handler Notification handler
+/// \param user_data User data passed to the handler
+///
+/// \see jrpc_server_register_method
+/// \see jrpc_notification_fn
+extern JRPC_API void jrpc_server_register_notification(
+    struct jrpc_server * server,
+    char const * method_name,
+    jrpc_notification_fn * handler,
+    void * user_data);
+
+/// \brief Registers a notification handler, that receives undecoded params.
+///
+/// \param server Instance of the server
+/// \param method_name Name of the notification
+/// \param handler Raw notification handler
+/// \param user_data User data passed to the handler
+///
+/// \see jrpc_server_register_notification
+/// \see jrpc_notification_raw_fn
+extern JRPC_API void jrpc_server_register_notification_raw(
+    struct jrpc_server * server,
+    char const * method_name,
+    jrpc_notification_raw_fn * handler,
+    void * user_data);
+
 /// \brief Sets the connection handler.
 ///
 /// The connection handler will be called, whenever a new connection is
@@ -269,6 +794,442 @@ extern JRPC_API void jrpc_server_set_userdata(
 extern JRPC_API void * jrpc_server_get_userdata(
     struct jrpc_server * server);
 
+/// \brief Sets the limits of the server's message pool.
+///
+/// Outgoing messages are allocated from a pool of size classes,
+/// ranging from 256 bytes up to 64 KiB. Released messages are
+/// kept for reuse as long as both limits are met; larger
+/// messages are never retained.
+///
+/// \note If not set, up to 64 messages per size class and
+///       4 MiB in total are retained.
+///
+/// \param server Instance of the server
+/// \param max_messages_per_class Maximum number of messages retained per size class
+/// \param max_bytes Maximum number of bytes retained in total
+///
+/// \see jrpc_server_get_message_pool_stats
+extern JRPC_API void jrpc_server_set_message_pool_limits(
+    struct jrpc_server * server,
+    size_t max_messages_per_class,
+    size_t max_bytes);
+
+/// \brief Retrieves statistics of the server's message pool.
+///
+/// \note The statistics of all service threads are summed up. Counters
+///       of other threads are read without synchronization while they
+///       change, so the result is approximate.
+///
+/// \param server Instance of the server
+/// \param stats Pointer to statistics to fill
+///
+/// \see jrpc_server_set_message_pool_limits
+extern JRPC_API void jrpc_server_get_message_pool_stats(
+    struct jrpc_server * server,
+    struct jrpc_message_pool_stats * stats);
+
+/// \brief Sets the budget of a single write to a connection.
+///
+/// Whenever a connection becomes writeable, queued messages are sent
+/// until either the socket reports pressure or the budget is exhausted.
+/// The remaining messages are sent on the next writeable callback,
+/// so that a busy connection cannot starve the others.
+///
+/// \note If not set, up to 32 messages or 64 KiB are sent at once.
+///       A limit of 0 is treated as 1. A single message (or fragment)
+///       may exceed the byte budget. If the socket already reports
+///       pressure, when the connection becomes writeable, nothing is
+///       sent until the next writeable callback.
+///
+/// \param server Instance of the server
+/// \param max_messages Maximum number of messages sent per callback
+/// \param max_bytes Maximum number of bytes sent per callback
+///
+/// \see jrpc_server_get_write_stats
+extern JRPC_API void jrpc_server_set_write_budget(
+    struct jrpc_server * server,
+    size_t max_messages,
+    size_t max_bytes);
+
+/// \brief Sets the size of websocket fragments of large messages.
+///
+/// Messages larger than the fragment size are sent as a sequence of
+/// websocket continuation fragments, one or more per writeable callback,
+/// as the write budget allows. A single large message therefore cannot
+/// stall the other connections of a service thread. Since fragments of
+/// different messages cannot be interleaved, other messages to the same
+/// connection are sent after the last fragment.
+///
+/// \note If not set, messages larger than 64 KiB are fragmented.
+///       Must be set before jrpc_server_start; once the server is
+///       started, the fragment size cannot be changed any more.
+///
+/// \param server Instance of the server
+/// \param fragment_size Maximum payload of a fragment in bytes (0 to disable)
+///
+/// \see jrpc_server_set_write_budget
+extern JRPC_API void jrpc_server_set_fragment_size(
+    struct jrpc_server * server,
+    size_t fragment_size);
+
+/// \brief Retrieves statistics of the server's write path.
+///
+/// Divide messages_sent by writeable_callbacks to get the average
+/// number of messages sent per callback.
+///
+/// \note The statistics of all service threads are summed up. Counters
+///       of other threads are read without synchronization while they
+///       change, so the result is approximate.
+///
+/// \param server Instance of the server
+/// \param stats Pointer to statistics to fill
+///
+/// \see jrpc_server_set_write_budget
+extern JRPC_API void jrpc_server_get_write_stats(
+    struct jrpc_server * server,
+    struct jrpc_write_stats * stats);
+
+/// \brief Sets the maximum size of a received message.
+///
+/// Messages sent in several websocket fragments are reassembled
+/// before they are processed. Connections, that send a larger
+/// message are closed with status 1009 (message too large) as
+/// soon as the announced payload exceeds the limit.
+///
+/// \note If not set, messages are limited to 16 MiB.
+///
+/// \param server Instance of the server
+/// \param max_message_size Maximum message size in bytes (0 for unlimited)
+extern JRPC_API void jrpc_server_set_max_message_size(
+    struct jrpc_server * server,
+    size_t max_message_size);
+
+/// \brief Limits the outbound queue of each connection.
+///
+/// Messages that cannot be sent immediately are queued per connection.
+/// Once a queue exceeds one of the limits, the policy is applied.
+///
+/// \note If not set, outbound queues are unlimited.
+///
+/// \param server Instance of the server
+/// \param max_bytes Maximum number of queued bytes per connection (0 for unlimited)
+/// \param max_messages Maximum number of queued messages per connection (0 for unlimited)
+/// \param policy Policy applied when a queue is full
+///
+/// \see jrpc_overflow_policy
+/// \see jrpc_connection_get_dropped_messages
+extern JRPC_API void jrpc_server_set_outbound_limit(
+    struct jrpc_server * server,
+    size_t max_bytes,
+    size_t max_messages,
+    enum jrpc_overflow_policy policy);
+
+/// \brief Sets the watermarks of each connection's outbound queue.
+///
+/// \note If not set, watermark callbacks are disabled.
+///
+/// \param server Instance of the server
+/// \param low_watermark Queued bytes at which a congested connection recovers
+/// \param high_watermark Queued bytes at which a connection becomes congested (0 to disable)
+///
+/// \see jrpc_server_set_onhighwatermark
+/// \see jrpc_server_set_onlowwatermark
+/// \see jrpc_connection_is_congested
+extern JRPC_API void jrpc_server_set_outbound_watermarks(
+    struct jrpc_server * server,
+    size_t low_watermark,
+    size_t high_watermark);
+
+/// \brief Sets the handler invoked when a connection reaches the high watermark.
+///
+/// \param server Instance of the server
+/// \param handler High watermark handler
+///
+/// \see jrpc_watermark_fn
+extern JRPC_API void jrpc_server_set_onhighwatermark(
+    struct jrpc_server * server,
+    jrpc_watermark_fn * handler);
+
+/// \brief Sets the handler invoked when a congested connection drained to the low watermark.
+///
+/// \param server Instance of the server
+/// \param handler Low watermark handler
+///
+/// \see jrpc_watermark_fn
+extern JRPC_API void jrpc_server_set_onlowwatermark(
+    struct jrpc_server * server,
+    jrpc_watermark_fn * handler);
+
+/// \brief Sets how outbound lanes of a connection are weighted.
+///
+/// While both lanes hold messages, up to weight messages of the high
+/// priority lane (responses, errors and high priority notifications)
+/// are written before one message of the normal lane. This keeps the
+/// latency of responses low under notification load, without starving
+/// notifications.
+///
+/// \note Defaults to 8. A weight of 0 is treated as 1, which serves
+///       both lanes alternately.
+///
+/// \param server Instance of the server
+/// \param weight High priority messages per normal priority message
+///
+/// \see jrpc_priority
+/// \see jrpc_notify_priority
+extern JRPC_API void jrpc_server_set_priority_weight(
+    struct jrpc_server * server,
+    size_t weight);
+
+/// \brief Enables tracking of outstanding requests with a deadline.
+///
+/// Each request is tracked until it is answered. If it is not answered
+/// within the timeout, an error with code JRPC_TIMEOUT_ERROR_CODE is sent
+/// instead. A late response to such a request is discarded. Requests of
+/// a closed connection are dropped.
+///
+/// \note If not set, requests are not tracked (timeout 0). Must be set
+///       before the first call of jrpc_server_run.
+///
+/// \param server Instance of the server
+/// \param timeout_ms Timeout of a request in milliseconds (0 to disable)
+///
+/// \see jrpc_server_get_pending_requests
+/// \see jrpc_connection_get_pending_requests
+extern JRPC_API void jrpc_server_set_request_timeout(
+    struct jrpc_server * server,
+    unsigned int timeout_ms);
+
+/// \brief Returns the number of requests waiting for a response.
+///
+/// \note Requests are only tracked, if a request timeout is set or
+///       request cancellation is enabled.
+///
+/// \note With several service threads, the counts of other threads
+///       are read while they change, so the result is approximate.
+///
+/// \param server Instance of the server
+/// \return Number of outstanding requests of all connections
+///
+/// \see jrpc_server_set_request_timeout
+extern JRPC_API size_t jrpc_server_get_pending_requests(
+    struct jrpc_server * server);
+
+/// \brief Enables micro-batching of notifications for clients, that opt in.
+///
+/// Clients opt in by requesting the websocket protocol
+/// "<protocol name>.batch" (e.g. "jrpc.batch") instead of the plain
+/// protocol name. Notifications to such clients are held back for up
+/// to the given window or until max_bytes are queued. Consecutive
+/// notifications are then sent as a single JSON array frame, like a
+/// JSON-RPC batch. Responses are never held back; they flush held
+/// notifications queued before them.
+///
+/// \note Disabled by default. The window is rounded up to whole
+///       milliseconds. Must be set before the first call of
+///       jrpc_server_run.
+///
+/// \param server Instance of the server
+/// \param window_us Maximum time to hold back a notification in
+///        microseconds (0 to disable)
+/// \param max_bytes Maximum size of a batch in bytes (0 for 16 KiB)
+///
+/// \see jrpc_server_set_protocolname
+extern JRPC_API void jrpc_server_set_notification_batching(
+    struct jrpc_server * server,
+    unsigned int window_us,
+    size_t max_bytes);
+
+/// \brief Enables the request cancellation protocol.
+///
+/// If enabled, a client may cancel an outstanding request by sending
+/// the notification "$/cancelRequest" with params {"id": <request id>}.
+/// The response to a cancelled request is suppressed. Requests of a
+/// connection that closes are cancelled, too.
+///
+/// \note Disabled by default. Must be set before the first call of
+///       jrpc_server_run.
+///
+/// \param server Instance of the server
+/// \param enabled true to enable request cancellation
+///
+/// \see jrpc_server_set_oncancel
+/// \see jrpc_is_cancelled
+extern JRPC_API void jrpc_server_set_request_cancellation(
+    struct jrpc_server * server,
+    bool enabled);
+
+/// \brief Sets the handler invoked when a request is cancelled.
+///
+/// \param server Instance of the server
+/// \param handler Cancel handler
+///
+/// \see jrpc_cancel_fn
+extern JRPC_API void jrpc_server_set_oncancel(
+    struct jrpc_server * server,
+    jrpc_cancel_fn * handler);
+
+/// \brief Sets the number of service threads.
+///
+/// Each service thread runs its own event loop, listening on the
+/// same port. Connections are distributed among the loops by the kernel
+/// and stay on their loop for their whole lifetime. The first loop is
+/// serviced by the thread calling jrpc_server_run; additional loops
+/// run on threads created by the first call of jrpc_server_run.
+///
+/// \note With more than one service thread, callbacks are invoked
+///       concurrently from different threads. Callbacks of a single
+///       connection are always invoked from the same thread. A connection
+///       must only be used by the thread servicing it; use the thread-safe
+///       functions to reach connections of other loops. jrpc_notify_all,
+///       jrpc_notify_many and jrpc_publish reach connections of all loops.
+///
+/// \note If not set, a single service thread is used. Must be set before
+///       the first call of jrpc_server_run.
+///
+/// \param server Instance of the server
+/// \param thread_count Number of service threads (1 to 256)
+///
+/// \see jrpc_server_set_cpu_affinity
+extern JRPC_API void jrpc_server_set_service_threads(
+    struct jrpc_server * server,
+    size_t thread_count);
+
+/// \brief Pins the additional service threads to CPUs.
+///
+/// The n-th service thread is pinned to CPU n (modulo the number of
+/// online CPUs). The thread calling jrpc_server_run is not pinned.
+///
+/// \param server Instance of the server
+/// \param enabled true to pin service threads to CPUs
+///
+/// \see jrpc_server_set_service_threads
+extern JRPC_API void jrpc_server_set_cpu_affinity(
+    struct jrpc_server * server,
+    bool enabled);
+
+/// \brief Sets a handler to run the server within an external event loop.
+///
+/// Instead of calling jrpc_server_run, the server can be integrated into
+/// an existing event loop (e.g. epoll or libuv):
+///
+/// - call jrpc_server_start to create the server's sockets; they
+///   are reported to the handler
+/// - call jrpc_server_service_fd, whenever a watched file descriptor
+///   becomes ready
+/// - call jrpc_server_service_timers, when the timeout returned by
+///   jrpc_server_get_timeout expired
+///
+/// Since all callbacks are invoked from the external event loop, handlers
+/// may respond directly without any thread hop.
+///
+/// \note Must be set before jrpc_server_start. Only the first service loop
+///       is integrated; additional service threads keep their own loops.
+///
+/// \param server Instance of the server
+/// \param handler Poll handler
+/// \param user_data User data passed to the handler
+///
+/// \see jrpc_poll_fn
+extern JRPC_API void jrpc_server_set_onpoll(
+    struct jrpc_server * server,
+    jrpc_poll_fn * handler,
+    void * user_data);
+
+/// \brief Starts the server without servicing it.
+///
+/// \note All configuration must be done before this function is called.
+///       It is called implicitly by jrpc_server_run.
+///
+/// \param server Instance of the server
+/// \return true, if the server is started; false, if the server's socket
+///         could not be created (e.g. because the port is in use). In
+///         that case, the server stays unstarted and the next call
+///         tries again.
+///
+/// \see jrpc_server_set_onpoll
+extern JRPC_API bool jrpc_server_start(
+    struct jrpc_server * server);
+
+/// \brief Services a file descriptor reported by jrpc_poll_fn.
+///
+/// \param server Instance of the server
+/// \param fd File descriptor, that became ready
+/// \param revents Events, that occurred (POLLIN, POLLOUT, POLLHUP, ...)
+///
+/// \see jrpc_server_set_onpoll
+extern JRPC_API void jrpc_server_service_fd(
+    struct jrpc_server * server,
+    int fd,
+    int revents);
+
+/// \brief Returns how long the external event loop may wait.
+///
+/// The timeout is limited by the next due timer of the server, e.g. a
+/// timer added by jrpc_server_add_timer or a request timeout.
+///
+/// \param server Instance of the server
+/// \param max_timeout_ms Longest timeout the caller would wait (negative for infinite)
+/// \return Timeout in milliseconds; 0 if jrpc_server_service_timers
+///         should be called immediately
+///
+/// \see jrpc_server_service_timers
+extern JRPC_API int jrpc_server_get_timeout(
+    struct jrpc_server * server,
+    int max_timeout_ms);
+
+/// \brief Services timers and pending work of the server.
+///
+/// \note Must be called at least once per second, even if no file
+///        descriptor became ready.
+///
+/// \param server Instance of the server
+///
+/// \see jrpc_server_get_timeout
+extern JRPC_API void jrpc_server_service_timers(
+    struct jrpc_server * server);
+
+/// \brief Adds a one-shot or periodic timer to the server's loop.
+///
+/// Timers are kept in a hierarchical timing wheel with a resolution
+/// of one millisecond, so adding and cancelling a timer is O(1).
+///
+/// \note This function must be called by the thread running the server.
+///       With several service threads, the timer is added to the loop of
+///       the calling thread. Called from any other thread, no timer is
+///       added and 0 is returned.
+///
+/// \param server Instance of the server
+/// \param timeout_ms Milliseconds until the timer fires first
+/// \param interval_ms Milliseconds between further invocations
+///        (0 for a one-shot timer)
+/// \param handler Timer handler
+/// \param user_data User data passed to the handler
+/// \return Identifier of the timer or 0 on error
+///
+/// \see jrpc_server_cancel_timer
+extern JRPC_API jrpc_timer_id jrpc_server_add_timer(
+    struct jrpc_server * server,
+    unsigned int timeout_ms,
+    unsigned int interval_ms,
+    jrpc_timer_fn * handler,
+    void * user_data);
+
+/// \brief Cancels a timer.
+///
+/// Cancelling a timer, that already fired or was cancelled before,
+/// has no effect. A periodic timer may cancel itself within its handler.
+///
+/// \note This function must be called by the thread servicing the
+///       timer's loop.
+///
+/// \param server Instance of the server
+/// \param id Identifier of the timer
+///
+/// \see jrpc_server_add_timer
+extern JRPC_API void jrpc_server_cancel_timer(
+    struct jrpc_server * server,
+    jrpc_timer_id id);
+
 /// \brief Runs the server until some event occurs or timeout.
 ///
 /// \note All configuration must be done before the first call
@@ -289,9 +1250,11 @@ extern JRPC_API void jrpc_server_run(
 /// This function is used to safely interrupt jrpc_server_run from
 /// another thread.
 ///
-/// \not This is the only function that can be called safely from
-///      a foreign thread context. All other functions must be
-///      called from the thread, which is running JRPC server.
+/// \note Besides jrpc_respond_threadsafe, jrpc_respond_error_threadsafe,
+///       jrpc_notify_threadsafe, jrpc_notify_many, jrpc_notify_all,
+///       jrpc_publish and jrpc_server_offload, this is the only function
+///       that can be called safely from a foreign thread context. All other functions
+///       must be called from the thread, which is running JRPC server.
 ///
 /// \params server Instance of the server
 ///
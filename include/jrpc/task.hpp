@@ -0,0 +1,690 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_TASK_HPP
+#define JRPC_TASK_HPP
+
+#if __cplusplus < 202002L
+#error "jrpc/task.hpp requires C++20"
+#endif
+
+#include <jrpc.h>
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace jrpc
+{
+
+/// \brief Result of a method; ownership is transferred to the caller.
+using json = json_t *;
+
+/// \brief Exception to answer a method with an error.
+///
+/// Any other exception escaping a method is answered with error code -1
+/// and message "internal error".
+class error: public std::runtime_error
+{
+public:
+    error(int code, std::string const & message)
+    : std::runtime_error(message)
+    , code_(code)
+    {
+    }
+
+    int code() const noexcept
+    {
+        return code_;
+    }
+
+private:
+    int code_;
+};
+
+namespace detail
+{
+
+// Coroutine frames are recycled per thread. Since each loop is serviced by
+// exactly one thread and frames are resumed on the loop they were created
+// on, this is a per-loop pool without locking.
+class frame_pool
+{
+public:
+    static void * allocate(std::size_t size)
+    {
+        std::size_t const index = size_class(size);
+        if (index < class_count)
+        {
+            free_lists & cache = get_cache();
+            node * item = cache.lists[index];
+            if (nullptr != item)
+            {
+                cache.lists[index] = item->next;
+                cache.counts[index]--;
+                return item;
+            }
+
+            return ::operator new(index * granularity);
+        }
+
+        return ::operator new(size);
+    }
+
+    static void deallocate(void * pointer, std::size_t size) noexcept
+    {
+        std::size_t const index = size_class(size);
+        if (index < class_count)
+        {
+            free_lists & cache = get_cache();
+            if (cache.counts[index] < max_cached)
+            {
+                node * item = static_cast<node *>(pointer);
+                item->next = cache.lists[index];
+                cache.lists[index] = item;
+                cache.counts[index]++;
+                return;
+            }
+        }
+
+        ::operator delete(pointer);
+    }
+
+private:
+    static constexpr std::size_t granularity = 64;
+    static constexpr std::size_t class_count = 33;
+    static constexpr std::size_t max_cached = 1024;
+
+    struct node
+    {
+        node * next;
+    };
+
+    struct free_lists
+    {
+        node * lists[class_count] = {};
+        std::size_t counts[class_count] = {};
+
+        ~free_lists()
+        {
+            for(node * item: lists)
+            {
+                while (nullptr != item)
+                {
+                    node * next = item->next;
+                    ::operator delete(item);
+                    item = next;
+                }
+            }
+        }
+    };
+
+    static std::size_t size_class(std::size_t size) noexcept
+    {
+        return (size + granularity - 1) / granularity;
+    }
+
+    static free_lists & get_cache()
+    {
+        thread_local free_lists cache;
+        return cache;
+    }
+};
+
+struct pooled_frame
+{
+    static void * operator new(std::size_t size)
+    {
+        return frame_pool::allocate(size);
+    }
+
+    static void operator delete(void * pointer, std::size_t size) noexcept
+    {
+        frame_pool::deallocate(pointer, size);
+    }
+};
+
+struct promise_base: pooled_frame
+{
+    struct final_awaiter
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            std::coroutine_handle<> continuation = handle.promise().continuation;
+            return (continuation) ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept
+        {
+        }
+    };
+
+    std::suspend_always initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    final_awaiter final_suspend() noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        exception = std::current_exception();
+    }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+};
+
+template<typename T>
+struct task_promise: promise_base
+{
+    void return_value(T value)
+    {
+        result.emplace(std::move(value));
+    }
+
+    T take_result()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+
+        return std::move(*result);
+    }
+
+    std::optional<T> result;
+};
+
+template<>
+struct task_promise<void>: promise_base
+{
+    void return_void() noexcept
+    {
+    }
+
+    void take_result()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+}
+
+/// \brief Lazily started coroutine, resumed by the loop it was created on.
+///
+/// A task starts running, when it is awaited. Awaiting a task suspends
+/// the awaiting coroutine until the task completes; exceptions are
+/// propagated to the awaiting coroutine.
+///
+/// \see register_method
+template<typename T = void>
+class task
+{
+public:
+    struct promise_type: detail::task_promise<T>
+    {
+        task get_return_object() noexcept
+        {
+            return task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
+
+    task(task && other) noexcept
+    : handle_(std::exchange(other.handle_, nullptr))
+    {
+    }
+
+    task & operator=(task && other) noexcept
+    {
+        if (this != &other)
+        {
+            destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+
+        return *this;
+    }
+
+    task(task const &) = delete;
+    task & operator=(task const &) = delete;
+
+    ~task()
+    {
+        destroy();
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct awaiter
+        {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+            {
+                handle.promise().continuation = continuation;
+                return handle;
+            }
+
+            T await_resume()
+            {
+                return handle.promise().take_result();
+            }
+        };
+
+        return awaiter{handle_};
+    }
+
+private:
+    explicit task(std::coroutine_handle<promise_type> handle) noexcept
+    : handle_(handle)
+    {
+    }
+
+    void destroy() noexcept
+    {
+        if (handle_)
+        {
+            handle_.destroy();
+            handle_ = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+/// \brief Request a method coroutine answers.
+///
+/// The request refers to its connection by handle, so it can be kept
+/// across suspension points, even if the connection is closed meanwhile.
+class request
+{
+public:
+    request(jrpc_connection * connection, int id)
+    : server_(jrpc_connection_get_server(connection))
+    , handle_(jrpc_connection_get_handle(connection))
+    , id_(id)
+    {
+    }
+
+    jrpc_server * server() const noexcept
+    {
+        return server_;
+    }
+
+    jrpc_connection_handle handle() const noexcept
+    {
+        return handle_;
+    }
+
+    int id() const noexcept
+    {
+        return id_;
+    }
+
+    /// \brief Returns the connection or nullptr, if it is closed.
+    jrpc_connection * connection() const
+    {
+        return jrpc_server_get_connection(server_, handle_);
+    }
+
+    /// \brief Returns true, if the response will be discarded.
+    ///
+    /// \see jrpc_is_cancelled
+    bool is_cancelled() const
+    {
+        jrpc_connection * connection = this->connection();
+        return (nullptr == connection) || (jrpc_is_cancelled(connection, id_));
+    }
+
+private:
+    jrpc_server * server_;
+    jrpc_connection_handle handle_;
+    int id_;
+};
+
+/// \brief Method implemented as coroutine.
+///
+/// \param request Request to answer
+/// \param params JSON-array or JSON-object containing the arguments of the method;
+///        remains valid until the method completes
+/// \param user_data User data specified at registration
+/// \return Result of the method (ownership is transferred)
+using method_fn = task<json>(request request, json_t * params, void * user_data);
+
+namespace detail
+{
+
+struct detached
+{
+    struct promise_type: pooled_frame
+    {
+        detached get_return_object() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+inline void respond(request const & request, json result)
+{
+    jrpc_connection * connection = request.connection();
+    if (nullptr != connection)
+    {
+        jrpc_respond(connection, result, request.id());
+    }
+    else
+    {
+        json_decref(result);
+    }
+}
+
+inline void respond_error(request const & request, int code, char const * message)
+{
+    jrpc_connection * connection = request.connection();
+    if (nullptr != connection)
+    {
+        jrpc_respond_error(connection, code, message, request.id());
+    }
+}
+
+inline detached run(request request, json_t * params, task<json> method)
+{
+    try
+    {
+        json result = co_await std::move(method);
+        respond(request, result);
+    }
+    catch (error const & ex)
+    {
+        respond_error(request, ex.code(), ex.what());
+    }
+    catch (...)
+    {
+        respond_error(request, -1, "internal error");
+    }
+
+    json_decref(params);
+}
+
+template<method_fn * Method>
+void invoke(jrpc_connection * connection, json_t * params, int id, void * user_data)
+{
+    json_incref(params);
+    try
+    {
+        request const request(connection, id);
+        run(request, params, Method(request, params, user_data));
+    }
+    catch (...)
+    {
+        json_decref(params);
+        jrpc_respond_error(connection, -1, "internal error", id);
+    }
+}
+
+template<typename T>
+using value_or_monostate = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+}
+
+/// \brief Answers a request with the result of a task.
+///
+/// The task is started immediately; its result (or error) is sent once
+/// it completes.
+///
+/// \param connection Connection of the request
+/// \param id ID of the request
+/// \param method Task computing the result
+inline void spawn(jrpc_connection * connection, int id, task<json> method)
+{
+    detail::run(request(connection, id), nullptr, std::move(method));
+}
+
+/// \brief Registers a coroutine as method.
+///
+/// \code
+/// jrpc::task<jrpc::json> sum(jrpc::request request, json_t * params, void * user_data)
+/// {
+///     int value = co_await jrpc::offload(request.server(), [params]() { return slow_sum(params); });
+///     co_return json_integer(value);
+/// }
+///
+/// jrpc::register_method<&sum>(server, "sum");
+/// \endcode
+///
+/// \param server Instance of the server
+/// \param method_name Name of the method
+/// \param user_data User data passed to the method
+template<method_fn * Method>
+void register_method(jrpc_server * server, char const * method_name, void * user_data = nullptr)
+{
+    jrpc_server_register_method(server, method_name, &detail::invoke<Method>, user_data);
+}
+
+/// \brief Awaitable running work on the worker pool.
+///
+/// \see offload
+template<typename Work>
+class offload_awaiter
+{
+public:
+    using result_type = std::invoke_result_t<Work &>;
+
+    offload_awaiter(jrpc_server * server, Work work)
+    : server_(server)
+    , work_(std::move(work))
+    , is_submitted_(false)
+    {
+    }
+
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> continuation)
+    {
+        continuation_ = continuation;
+        is_submitted_ = jrpc_server_offload(server_, &offload_awaiter::run, &offload_awaiter::done, this);
+        return is_submitted_;
+    }
+
+    result_type await_resume()
+    {
+        if (!is_submitted_)
+        {
+            throw error(-1, "not available");
+        }
+
+        if (exception_)
+        {
+            std::rethrow_exception(exception_);
+        }
+
+        if constexpr (!std::is_void_v<result_type>)
+        {
+            return std::move(*result_);
+        }
+    }
+
+private:
+    static void run(void * user_data)
+    {
+        offload_awaiter * self = static_cast<offload_awaiter *>(user_data);
+        try
+        {
+            if constexpr (std::is_void_v<result_type>)
+            {
+                self->work_();
+                self->result_.emplace();
+            }
+            else
+            {
+                self->result_.emplace(self->work_());
+            }
+        }
+        catch (...)
+        {
+            self->exception_ = std::current_exception();
+        }
+    }
+
+    static void done(jrpc_server *, void * user_data)
+    {
+        static_cast<offload_awaiter *>(user_data)->continuation_.resume();
+    }
+
+    jrpc_server * server_;
+    Work work_;
+    bool is_submitted_;
+    std::coroutine_handle<> continuation_;
+    std::optional<detail::value_or_monostate<result_type>> result_;
+    std::exception_ptr exception_;
+};
+
+/// \brief Runs work on the worker pool and resumes on the current loop.
+///
+/// The awaiting coroutine is suspended without blocking the loop.
+/// Exceptions thrown by the work are rethrown on resumption. If the
+/// worker pool is not running, jrpc::error(-1, "not available") is thrown.
+///
+/// \note The work must not call any JRPC function other than those
+///       documented as thread-safe. As with sleep_for, a coroutine
+///       awaiting work, when the server is disposed, is never resumed.
+///
+/// \param server Instance of the server
+/// \param work Callable run by a worker thread
+///
+/// \see jrpc_server_offload
+template<typename Work>
+offload_awaiter<std::decay_t<Work>> offload(jrpc_server * server, Work && work)
+{
+    return offload_awaiter<std::decay_t<Work>>(server, std::forward<Work>(work));
+}
+
+/// \brief Awaitable suspending for a duration.
+///
+/// \see sleep_for
+class sleep_awaiter
+{
+public:
+    sleep_awaiter(jrpc_server * server, unsigned int timeout_ms)
+    : server_(server)
+    , timeout_ms_(timeout_ms)
+    {
+    }
+
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> continuation)
+    {
+        continuation_ = continuation;
+        return (0 != jrpc_server_add_timer(server_, timeout_ms_, 0, &sleep_awaiter::fire, this));
+    }
+
+    void await_resume() noexcept
+    {
+    }
+
+private:
+    static void fire(jrpc_server *, jrpc_timer_id, void * user_data)
+    {
+        static_cast<sleep_awaiter *>(user_data)->continuation_.resume();
+    }
+
+    jrpc_server * server_;
+    unsigned int timeout_ms_;
+    std::coroutine_handle<> continuation_;
+};
+
+/// \brief Suspends the awaiting coroutine using a timer of the current loop.
+///
+/// If the timer cannot be added, the coroutine continues immediately.
+///
+/// \note If the server is disposed while the coroutine is suspended,
+///       its timer is released without firing. The coroutine is never
+///       resumed, so its frame, including all locals and the frames of
+///       awaiting coroutines, is leaked.
+///
+/// \param server Instance of the server
+/// \param duration Duration to sleep
+///
+/// \see jrpc_server_add_timer
+inline sleep_awaiter sleep_for(jrpc_server * server, std::chrono::milliseconds duration)
+{
+    return sleep_awaiter(server, static_cast<unsigned int>(duration.count()));
+}
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/batch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct jrpc_batch * jrpc_batch_create(
+    int const * ids,
+    size_t count)
+{
+    struct jrpc_batch * batch = malloc(sizeof(struct jrpc_batch) + (count * sizeof(int)));
+    if (NULL != batch)
+    {
+        batch->next = NULL;
+        batch->responses = json_array();
+        batch->ids = (int *) &batch[1];
+        batch->pending = count;
+        batch->is_dispatched = false;
+
+        memcpy(batch->ids, ids, count * sizeof(int));
+    }
+
+    return batch;
+}
+
+void jrpc_batch_dispose(
+    struct jrpc_batch * batch)
+{
+    json_decref(batch->responses);
+    free(batch);
+}
+
+bool jrpc_batch_add_response(
+    struct jrpc_batch * batch,
+    json_t * response,
+    int id)
+{
+    for(size_t i = 0; i < batch->pending; i++)
+    {
+        if (id == batch->ids[i])
+        {
+            batch->pending--;
+            batch->ids[i] = batch->ids[batch->pending];
+            if (NULL != response)
+            {
+                json_array_append_new(batch->responses, response);
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool jrpc_batch_is_complete(
+    struct jrpc_batch const * batch)
+{
+    return ((batch->is_dispatched) && (0 == batch->pending));
+}
@@ -0,0 +1,72 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_BATCH_H
+#define JRPC_BATCH_H
+
+#include <jansson.h>
+
+#ifndef __cplusplus
+#include <stddef.h>
+#include <stdbool.h>
+#else
+#include <cstddef>
+using ::std::size_t;
+#endif
+
+struct jrpc_batch
+{
+    struct jrpc_batch * next;
+    json_t * responses;
+    int * ids;
+    size_t pending;
+    bool is_dispatched;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern struct jrpc_batch * jrpc_batch_create(
+    int const * ids,
+    size_t count);
+
+extern void jrpc_batch_dispose(
+    struct jrpc_batch * batch);
+
+extern bool jrpc_batch_add_response(
+    struct jrpc_batch * batch,
+    json_t * response,
+    int id);
+
+extern bool jrpc_batch_is_complete(
+    struct jrpc_batch const * batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
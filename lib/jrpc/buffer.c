@@ -0,0 +1,82 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/buffer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define JRPC_BUFFER_INITIAL_CAPACITY 4096
+
+void jrpc_buffer_init(
+    struct jrpc_buffer * buffer)
+{
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+void jrpc_buffer_cleanup(
+    struct jrpc_buffer * buffer)
+{
+    free(buffer->data);
+    jrpc_buffer_init(buffer);
+}
+
+bool jrpc_buffer_append(
+    struct jrpc_buffer * buffer,
+    char const * data,
+    size_t length)
+{
+    size_t const required = buffer->length + length;
+    if (required > buffer->capacity)
+    {
+        size_t capacity = (0 < buffer->capacity) ? buffer->capacity : JRPC_BUFFER_INITIAL_CAPACITY;
+        while (capacity < required)
+        {
+            capacity *= 2;
+        }
+
+        char * grown = realloc(buffer->data, capacity);
+        if (NULL == grown)
+        {
+            return false;
+        }
+
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(&buffer->data[buffer->length], data, length);
+    buffer->length = required;
+
+    return true;
+}
+
+void jrpc_buffer_clear(
+    struct jrpc_buffer * buffer)
+{
+    buffer->length = 0;
+}
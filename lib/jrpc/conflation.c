@@ -0,0 +1,193 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/conflation.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define JRPC_CONFLATION_INITIAL_BUCKETS 16
+
+// Entries refer to queued messages by position. An entry is stale, once
+// its message was sent or dropped; stale entries are purged before the
+// table grows, so the table is bounded by the number of queued messages.
+
+static size_t jrpc_conflation_bucket(
+    size_t bucket_count,
+    char const * key)
+{
+    uint32_t hash = UINT32_C(2166136261);
+    for(unsigned char const * c = (unsigned char const *) key; '\0' != *c; c++)
+    {
+        hash ^= *c;
+        hash *= UINT32_C(16777619);
+    }
+
+    return hash & (bucket_count - 1);
+}
+
+static void jrpc_conflation_purge(
+    struct jrpc_conflation * conflation,
+    struct jrpc_queue const * queue)
+{
+    for(size_t i = 0; i < conflation->bucket_count; i++)
+    {
+        struct jrpc_conflation_entry * * link = &conflation->buckets[i];
+        while (NULL != *link)
+        {
+            struct jrpc_conflation_entry * entry = *link;
+            if (entry->message != jrpc_queue_get(queue, entry->position))
+            {
+                *link = entry->next;
+                conflation->count--;
+                free(entry->key);
+                free(entry);
+            }
+            else
+            {
+                link = &entry->next;
+            }
+        }
+    }
+}
+
+static bool jrpc_conflation_grow(
+    struct jrpc_conflation * conflation)
+{
+    size_t const bucket_count = (0 < conflation->bucket_count) ? (2 * conflation->bucket_count) : JRPC_CONFLATION_INITIAL_BUCKETS;
+    struct jrpc_conflation_entry * * buckets = calloc(bucket_count, sizeof(struct jrpc_conflation_entry *));
+    if (NULL == buckets)
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < conflation->bucket_count; i++)
+    {
+        struct jrpc_conflation_entry * entry = conflation->buckets[i];
+        while (NULL != entry)
+        {
+            struct jrpc_conflation_entry * next = entry->next;
+            size_t const bucket = jrpc_conflation_bucket(bucket_count, entry->key);
+            entry->next = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+
+    free(conflation->buckets);
+    conflation->buckets = buckets;
+    conflation->bucket_count = bucket_count;
+
+    return true;
+}
+
+void jrpc_conflation_init(
+    struct jrpc_conflation * conflation)
+{
+    conflation->buckets = NULL;
+    conflation->bucket_count = 0;
+    conflation->count = 0;
+}
+
+void jrpc_conflation_cleanup(
+    struct jrpc_conflation * conflation)
+{
+    for(size_t i = 0; i < conflation->bucket_count; i++)
+    {
+        struct jrpc_conflation_entry * entry = conflation->buckets[i];
+        while (NULL != entry)
+        {
+            struct jrpc_conflation_entry * next = entry->next;
+            free(entry->key);
+            free(entry);
+            entry = next;
+        }
+    }
+
+    free(conflation->buckets);
+    jrpc_conflation_init(conflation);
+}
+
+struct jrpc_conflation_entry * jrpc_conflation_get(
+    struct jrpc_conflation const * conflation,
+    char const * key)
+{
+    if (0 == conflation->count)
+    {
+        return NULL;
+    }
+
+    struct jrpc_conflation_entry * entry = conflation->buckets[jrpc_conflation_bucket(conflation->bucket_count, key)];
+    while ((NULL != entry) && (0 != strcmp(key, entry->key)))
+    {
+        entry = entry->next;
+    }
+
+    return entry;
+}
+
+bool jrpc_conflation_set(
+    struct jrpc_conflation * conflation,
+    struct jrpc_queue const * queue,
+    char const * key,
+    uint64_t position,
+    struct jrpc_message * message)
+{
+    struct jrpc_conflation_entry * entry = jrpc_conflation_get(conflation, key);
+    if (NULL == entry)
+    {
+        if (conflation->count >= conflation->bucket_count)
+        {
+            jrpc_conflation_purge(conflation, queue);
+            if ((conflation->count >= conflation->bucket_count) && (!jrpc_conflation_grow(conflation)))
+            {
+                return false;
+            }
+        }
+
+        entry = malloc(sizeof(struct jrpc_conflation_entry));
+        if (NULL == entry)
+        {
+            return false;
+        }
+
+        entry->key = strdup(key);
+        if (NULL == entry->key)
+        {
+            free(entry);
+            return false;
+        }
+
+        size_t const bucket = jrpc_conflation_bucket(conflation->bucket_count, key);
+        entry->next = conflation->buckets[bucket];
+        conflation->buckets[bucket] = entry;
+        conflation->count++;
+    }
+
+    entry->position = position;
+    entry->message = message;
+
+    return true;
+}
@@ -0,0 +1,84 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_CONFLATION_H
+#define JRPC_CONFLATION_H
+
+#include "jrpc/queue.h"
+
+#ifndef __cplusplus
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#else
+#include <cstddef>
+#include <cstdint>
+using ::std::size_t;
+#endif
+
+struct jrpc_message;
+
+struct jrpc_conflation_entry
+{
+    struct jrpc_conflation_entry * next;
+    char * key;
+    uint64_t position;
+    struct jrpc_message * message;
+};
+
+struct jrpc_conflation
+{
+    struct jrpc_conflation_entry * * buckets;
+    size_t bucket_count;
+    size_t count;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern void jrpc_conflation_init(
+    struct jrpc_conflation * conflation);
+
+extern void jrpc_conflation_cleanup(
+    struct jrpc_conflation * conflation);
+
+extern struct jrpc_conflation_entry * jrpc_conflation_get(
+    struct jrpc_conflation const * conflation,
+    char const * key);
+
+extern bool jrpc_conflation_set(
+    struct jrpc_conflation * conflation,
+    struct jrpc_queue const * queue,
+    char const * key,
+    uint64_t position,
+    struct jrpc_message * message);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -24,42 +24,628 @@
  */
 
 #include "jrpc/connection_intern.h"
+#include "jrpc/server_intern.h"
+#include "jrpc/protocol.h"
+#include "jrpc/loop.h"
 #include "jrpc/message.h"
+#include "jrpc/message_pool.h"
+#include "jrpc/batch.h"
+#include "jrpc/post.h"
 
 #include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 
 static void jrpc_connection_send(
     struct jrpc_connection * connection,
     json_t * message_data)
 {
-    struct jrpc_message * message = jrpc_message_create(message_data);
+    struct jrpc_message * message = jrpc_message_create(&connection->loop->pool, message_data);
     if (NULL != message)
     {
-        jrpc_queue_append(&connection->messages, message);
-        lws_callback_on_writable(connection->wsi);
+        jrpc_connection_enqueue(connection, message);
+        jrpc_message_dispose(message);
     }
 
     json_decref(message_data); 
 
 }
 
+static void jrpc_connection_flush_batch(
+    struct jrpc_connection * connection,
+    struct jrpc_batch * batch)
+{
+    if (0 < json_array_size(batch->responses))
+    {
+        struct jrpc_message * message = jrpc_message_create(&connection->loop->pool, batch->responses);
+        if (NULL != message)
+        {
+            jrpc_connection_enqueue(connection, message);
+            jrpc_message_dispose(message);
+        }
+    }
+
+    jrpc_batch_dispose(batch);
+}
+
+static void jrpc_connection_deliver(
+    struct jrpc_connection * connection,
+    json_t * response,
+    int id)
+{
+    struct jrpc_batch * * link = &connection->batches;
+    while (NULL != *link)
+    {
+        struct jrpc_batch * batch = *link;
+        if (jrpc_batch_add_response(batch, response, id))
+        {
+            if (jrpc_batch_is_complete(batch))
+            {
+                *link = batch->next;
+                jrpc_connection_flush_batch(connection, batch);
+            }
+
+            return;
+        }
+
+        link = &batch->next;
+    }
+
+    // no response: a cancelled request only completes its batch slot
+    if (NULL != response)
+    {
+        jrpc_connection_send(connection, response);
+    }
+}
+
+static json_t * jrpc_connection_create_error(
+    int error_code,
+    char const * error_message,
+    int id)
+{
+    json_t * error_holder = json_object();
+    json_object_set_new(error_holder, "code", json_integer(error_code));
+    json_object_set_new(error_holder, "message", json_string(error_message));
+
+    json_t * response = json_object();
+    json_object_set_new(response, "error", error_holder);
+    json_object_set_new(response, "id", json_integer(id));
+
+    return response;
+}
+
+static void jrpc_connection_ontimeout(
+    struct jrpc_timer * timer)
+{
+    struct jrpc_inflight_entry * entry = (struct jrpc_inflight_entry *) timer;
+    struct jrpc_connection * connection = entry->connection;
+    int const id = entry->id;
+    bool const is_cancelled = entry->is_cancelled;
+
+    jrpc_inflight_remove(&connection->inflight, id);
+    connection->loop->pending_requests--;
+    free(entry);
+
+    json_t * response = (!is_cancelled) ? jrpc_connection_create_error(JRPC_TIMEOUT_ERROR_CODE, "request timed out", id) : NULL;
+    jrpc_connection_deliver(connection, response, id);
+}
+
+static bool jrpc_connection_complete_request(
+    struct jrpc_connection * connection,
+    int id)
+{
+    if (!connection->protocol->is_tracking_requests)
+    {
+        return true;
+    }
+
+    struct jrpc_inflight_entry * entry = jrpc_inflight_remove(&connection->inflight, id);
+    if (NULL == entry)
+    {
+        // timed out already (or never requested): the client got an error
+        return false;
+    }
+
+    bool const is_cancelled = entry->is_cancelled;
+    jrpc_loop_cancel_timer(connection->loop, &entry->timer);
+    connection->loop->pending_requests--;
+    free(entry);
+
+    if (is_cancelled)
+    {
+        jrpc_connection_deliver(connection, NULL, id);
+    }
+
+    return (!is_cancelled);
+}
+
+static struct jrpc_message * jrpc_connection_create_notification(
+    struct jrpc_message_pool * pool,
+    char const * method,
+    json_t * params)
+{
+    json_t * notification = json_object();
+    json_object_set_new(notification, "method", json_string(method));
+    json_object_set_new(notification, "params", params);
+
+    struct jrpc_message * message = jrpc_message_create(pool, notification);
+    if (NULL != message)
+    {
+        message->type = JRPC_MESSAGE_NOTIFICATION;
+    }
+
+    json_decref(notification);
+
+    return message;
+}
+
+static struct jrpc_message_pool * jrpc_connection_acquire_pool(
+    struct jrpc_loop * loop,
+    struct jrpc_message_pool * local_pool)
+{
+    if (NULL != loop)
+    {
+        return &loop->pool;
+    }
+
+    // outside of any loop, messages are serialized into a private pool; they are only copied into posts
+    jrpc_message_pool_init(local_pool);
+    return local_pool;
+}
+
+static void jrpc_connection_release_pool(
+    struct jrpc_message_pool * pool,
+    struct jrpc_message_pool * local_pool)
+{
+    if (local_pool == pool)
+    {
+        jrpc_message_pool_cleanup(local_pool);
+    }
+}
+
+static void jrpc_connection_onflush(
+    struct jrpc_timer * timer)
+{
+    struct jrpc_connection * connection = (struct jrpc_connection *) (((char *) timer) - offsetof(struct jrpc_connection, flush_timer));
+
+    lws_callback_on_writable(connection->wsi);
+}
+
+static size_t jrpc_connection_queued_bytes(
+    struct jrpc_connection const * connection)
+{
+    return connection->messages.bytes + connection->priority_messages.bytes;
+}
+
+static size_t jrpc_connection_queued_messages(
+    struct jrpc_connection const * connection)
+{
+    return connection->messages.count + connection->priority_messages.count;
+}
+
+static void jrpc_connection_schedule_write(
+    struct jrpc_connection * connection,
+    struct jrpc_queue const * lane)
+{
+    struct jrpc_protocol const * protocol = connection->protocol;
+
+    if ((connection->is_batching) && (&connection->messages == lane) &&
+        (connection->messages.bytes < protocol->batch_max_bytes))
+    {
+        // hold notifications back until the window expires or enough bytes are queued
+        if (!connection->flush_timer.is_pending)
+        {
+            jrpc_loop_add_timer(connection->loop, &connection->flush_timer, protocol->batch_window_ms);
+        }
+    }
+    else
+    {
+        jrpc_loop_cancel_timer(connection->loop, &connection->flush_timer);
+        lws_callback_on_writable(connection->wsi);
+    }
+}
+
+static bool jrpc_connection_is_full(
+    struct jrpc_connection * connection,
+    struct jrpc_message * message)
+{
+    struct jrpc_protocol const * protocol = connection->protocol;
+    size_t const bytes = jrpc_connection_queued_bytes(connection);
+    size_t const count = jrpc_connection_queued_messages(connection);
+
+    return (((0 < protocol->outbound_max_bytes) && (bytes + message->length > protocol->outbound_max_bytes)) ||
+        ((0 < protocol->outbound_max_messages) && (count + 1 > protocol->outbound_max_messages)));
+}
+
+static void jrpc_connection_close(
+    struct jrpc_connection * connection)
+{
+    connection->is_closing = true;
+    connection->dropped_messages += jrpc_connection_queued_messages(connection);
+    jrpc_queue_cleanup(&connection->messages);
+    jrpc_queue_cleanup(&connection->priority_messages);
+    lws_set_timeout(connection->wsi, PENDING_TIMEOUT_CLOSE_SEND, LWS_TO_KILL_ASYNC);
+}
+
+static bool jrpc_connection_make_room(
+    struct jrpc_connection * connection,
+    struct jrpc_message * message)
+{
+    bool const is_response = (JRPC_MESSAGE_RESPONSE == message->type);
+
+    switch (connection->protocol->overflow_policy)
+    {
+    case JRPC_OVERFLOW_DROP_OLDEST:
+        while (jrpc_connection_is_full(connection, message))
+        {
+            // prioritized notifications are dropped last
+            struct jrpc_message * oldest = jrpc_queue_remove_oldest(&connection->messages, JRPC_MESSAGE_NOTIFICATION);
+            if (NULL == oldest)
+            {
+                oldest = jrpc_queue_remove_oldest(&connection->priority_messages, JRPC_MESSAGE_NOTIFICATION);
+            }
+
+            if (NULL == oldest)
+            {
+                break;
+            }
+
+            connection->dropped_messages++;
+            jrpc_message_dispose(oldest);
+        }
+        break;
+    case JRPC_OVERFLOW_CLOSE:
+        // responses are exempt, like with the drop policies
+        if (!is_response)
+        {
+            jrpc_connection_close(connection);
+            return false;
+        }
+        break;
+    case JRPC_OVERFLOW_DROP_NEWEST:
+        // fall-through
+    default:
+        break;
+    }
+
+    if ((!is_response) && (jrpc_connection_is_full(connection, message)))
+    {
+        connection->dropped_messages++;
+        return false;
+    }
+
+    return true;
+}
+
 void jrpc_connection_init(
     struct jrpc_connection * connection,
-    struct jrpc_server * server,
+    struct jrpc_loop * loop,
     struct lws * wsi
 )
 {
-    connection->server = server;
+    connection->server = loop->protocol->server;
+    connection->protocol = loop->protocol;
+    connection->loop = loop;
     connection->wsi = wsi;
     connection->user_data = NULL;
+    connection->batches = NULL;
+    jrpc_buffer_init(&connection->receive_buffer);
+    jrpc_inflight_init(&connection->inflight);
+    jrpc_subscriptions_init(&connection->subscriptions);
+    jrpc_conflation_init(&connection->conflation);
+    connection->dropped_messages = 0;
+    connection->conflated_messages = 0;
+    connection->is_congested = false;
+    connection->is_closing = false;
+    connection->is_batching = false;
+    connection->priority_credit = 0;
+    connection->fragmented = NULL;
+    connection->fragment_offset = 0;
+    jrpc_timer_init(&connection->flush_timer, &jrpc_connection_onflush);
+    connection->handle = jrpc_registry_add(&loop->registry, connection);
 
     jrpc_queue_init(&connection->messages);
+    jrpc_queue_init(&connection->priority_messages);
 }
 
 void jrpc_connection_cleanup(
     struct jrpc_connection * connection)
 {
+    jrpc_registry_remove(&connection->loop->registry, connection->handle);
+    jrpc_loop_cancel_timer(connection->loop, &connection->flush_timer);
+    jrpc_topics_unsubscribe_all(&connection->loop->topics, &connection->subscriptions);
+
+    while (NULL != connection->batches)
+    {
+        struct jrpc_batch * batch = connection->batches;
+        connection->batches = batch->next;
+        jrpc_batch_dispose(batch);
+    }
+
+    connection->loop->pending_requests -= connection->inflight.count;
+    jrpc_inflight_cleanup(&connection->inflight, &connection->loop->timers);
+
+    jrpc_buffer_cleanup(&connection->receive_buffer);
     jrpc_queue_cleanup(&connection->messages);
+    jrpc_queue_cleanup(&connection->priority_messages);
+    jrpc_conflation_cleanup(&connection->conflation);
+
+    if (NULL != connection->fragmented)
+    {
+        jrpc_message_dispose(connection->fragmented);
+    }
+}
+
+void jrpc_connection_track_request(
+    struct jrpc_connection * connection,
+    int id)
+{
+    struct jrpc_inflight_entry * entry = jrpc_inflight_add(&connection->inflight, id);
+    if (NULL != entry)
+    {
+        entry->connection = connection;
+        jrpc_timer_init(&entry->timer, &jrpc_connection_ontimeout);
+        if (0 < connection->protocol->request_timeout_ms)
+        {
+            jrpc_loop_add_timer(connection->loop, &entry->timer, connection->protocol->request_timeout_ms);
+        }
+        connection->loop->pending_requests++;
+    }
+}
+
+void jrpc_connection_cancel_request(
+    struct jrpc_connection * connection,
+    int id)
+{
+    struct jrpc_inflight_entry * entry = jrpc_inflight_find(&connection->inflight, id);
+    if ((NULL != entry) && (!entry->is_cancelled))
+    {
+        entry->is_cancelled = true;
+        connection->protocol->oncancel(connection, id);
+    }
+}
+
+void jrpc_connection_cancel_all(
+    struct jrpc_connection * connection)
+{
+    struct jrpc_inflight * inflight = &connection->inflight;
+    if (0 == inflight->count)
+    {
+        return;
+    }
+
+    // collect ids first: handlers may respond and thereby modify the table
+    int * ids = malloc(inflight->count * sizeof(int));
+    if (NULL == ids)
+    {
+        return;
+    }
+
+    size_t count = 0;
+    for(size_t i = 0; i < inflight->bucket_count; i++)
+    {
+        for(struct jrpc_inflight_entry * entry = inflight->buckets[i]; NULL != entry; entry = entry->next)
+        {
+            ids[count++] = entry->id;
+        }
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        jrpc_connection_cancel_request(connection, ids[i]);
+    }
+
+    free(ids);
+}
+
+struct jrpc_batch * jrpc_connection_begin_batch(
+    struct jrpc_connection * connection,
+    int const * ids,
+    size_t count)
+{
+    // created even without requests: rejected requests are answered within the batch
+    struct jrpc_batch * batch = jrpc_batch_create(ids, count);
+    if (NULL != batch)
+    {
+        batch->next = connection->batches;
+        connection->batches = batch;
+    }
+
+    return batch;
+}
+
+void jrpc_connection_reject_request(
+    struct jrpc_connection * connection,
+    struct jrpc_batch * batch)
+{
+    json_t * response = jrpc_connection_create_error(JRPC_INVALID_REQUEST_ERROR_CODE, "Invalid Request", 0);
+    json_object_set_new(response, "id", json_null());
+
+    if (NULL != batch)
+    {
+        json_array_append_new(batch->responses, response);
+    }
+    else
+    {
+        jrpc_connection_send(connection, response);
+    }
+}
+
+void jrpc_connection_reject_duplicate(
+    struct jrpc_connection * connection,
+    int id)
+{
+    // delivered untracked: the outstanding request keeps its entry
+    json_t * response = jrpc_connection_create_error(JRPC_INVALID_REQUEST_ERROR_CODE, "Invalid Request", id);
+    jrpc_connection_deliver(connection, response, id);
+}
+
+void jrpc_connection_end_batch(
+    struct jrpc_connection * connection,
+    struct jrpc_batch * batch)
+{
+    if (NULL == batch)
+    {
+        return;
+    }
+
+    batch->is_dispatched = true;
+    if (jrpc_batch_is_complete(batch))
+    {
+        struct jrpc_batch * * link = &connection->batches;
+        while (batch != *link)
+        {
+            link = &(*link)->next;
+        }
+
+        *link = batch->next;
+        jrpc_connection_flush_batch(connection, batch);
+    }
+}
+
+static void jrpc_connection_enqueue_to(
+    struct jrpc_connection * connection,
+    struct jrpc_queue * lane,
+    struct jrpc_message * message)
+{
+    struct jrpc_protocol * protocol = connection->protocol;
+
+    if ((connection->is_closing) ||
+        ((jrpc_connection_is_full(connection, message)) && (!jrpc_connection_make_room(connection, message))))
+    {
+        return;
+    }
+
+    if (!jrpc_queue_append(lane, jrpc_message_ref(message)))
+    {
+        jrpc_message_dispose(message);
+        return;
+    }
+
+    jrpc_connection_schedule_write(connection, lane);
+
+    if ((!connection->is_congested) && (0 < protocol->high_watermark) &&
+        (jrpc_connection_queued_bytes(connection) >= protocol->high_watermark))
+    {
+        connection->is_congested = true;
+        protocol->onhighwatermark(connection);
+    }
+}
+
+static struct jrpc_queue * jrpc_connection_next_lane(
+    struct jrpc_connection * connection)
+{
+    bool const has_priority = !jrpc_queue_is_empty(&connection->priority_messages);
+    bool const has_normal = !jrpc_queue_is_empty(&connection->messages);
+
+    // the normal lane is served once per priority_weight messages of the priority lane,
+    // so pushed notifications neither delay responses nor starve
+    if ((has_priority) && ((!has_normal) || (connection->priority_credit < connection->protocol->priority_weight)))
+    {
+        connection->priority_credit++;
+        return &connection->priority_messages;
+    }
+
+    connection->priority_credit = 0;
+    return (has_normal) ? &connection->messages : NULL;
+}
+
+static struct jrpc_message * jrpc_connection_dequeue_from(
+    struct jrpc_connection * connection,
+    struct jrpc_queue * lane)
+{
+    struct jrpc_protocol * protocol = connection->protocol;
+    struct jrpc_message * message = jrpc_queue_dequeue(lane);
+
+    if ((connection->is_congested) && (jrpc_connection_queued_bytes(connection) <= protocol->low_watermark))
+    {
+        connection->is_congested = false;
+        protocol->onlowwatermark(connection);
+    }
+
+    return message;
+}
+
+void jrpc_connection_enqueue(
+    struct jrpc_connection * connection,
+    struct jrpc_message * message)
+{
+    struct jrpc_queue * lane = (JRPC_MESSAGE_RESPONSE == message->type) ?
+        &connection->priority_messages : &connection->messages;
+
+    jrpc_connection_enqueue_to(connection, lane, message);
+}
+
+struct jrpc_message * jrpc_connection_dequeue(
+    struct jrpc_connection * connection)
+{
+    struct jrpc_queue * lane = jrpc_connection_next_lane(connection);
+    return (NULL != lane) ? jrpc_connection_dequeue_from(connection, lane) : NULL;
+}
+
+struct jrpc_message * jrpc_connection_dequeue_batch(
+    struct jrpc_connection * connection)
+{
+    struct jrpc_queue * queue = jrpc_connection_next_lane(connection);
+    if (&connection->messages != queue)
+    {
+        return (NULL != queue) ? jrpc_connection_dequeue_from(connection, queue) : NULL;
+    }
+
+    size_t const max_bytes = connection->protocol->batch_max_bytes;
+
+    // consecutive notifications are combined into a single array: [a,b,...]
+    size_t count = 0;
+    size_t length = 1;
+    for(uint64_t position = queue->head; position < jrpc_queue_get_tail(queue); position++)
+    {
+        struct jrpc_message const * message = jrpc_queue_get(queue, position);
+        if ((JRPC_MESSAGE_NOTIFICATION != message->type) ||
+            ((0 < count) && (length + message->length + 1 > max_bytes)))
+        {
+            break;
+        }
+
+        count++;
+        length += message->length + 1;
+    }
+
+    struct jrpc_message * batch = (1 < count) ? jrpc_message_pool_acquire(&connection->loop->pool, length) : NULL;
+    if (NULL == batch)
+    {
+        return jrpc_connection_dequeue_from(connection, queue);
+    }
+
+    batch->length = 0;
+    batch->refcount = 1;
+    batch->type = JRPC_MESSAGE_NOTIFICATION;
+    batch->next = NULL;
+    for(size_t i = 0; i < count; i++)
+    {
+        struct jrpc_message * message = jrpc_connection_dequeue_from(connection, queue);
+        batch->data[batch->length++] = (0 == i) ? '[' : ',';
+        memcpy(&batch->data[batch->length], message->data, message->length);
+        batch->length += message->length;
+        jrpc_message_dispose(message);
+    }
+    batch->data[batch->length++] = ']';
+
+    return batch;
+}
+
+bool jrpc_connection_has_messages(
+    struct jrpc_connection * connection)
+{
+    return ((NULL != connection->fragmented) ||
+        (!jrpc_queue_is_empty(&connection->priority_messages)) || (!jrpc_queue_is_empty(&connection->messages)));
+}
+
+bool jrpc_connection_needs_write(
+    struct jrpc_connection * connection)
+{
+    return ((NULL != connection->fragmented) || (!jrpc_queue_is_empty(&connection->priority_messages)) ||
+        ((!jrpc_queue_is_empty(&connection->messages)) && (!connection->flush_timer.is_pending)));
 }
 
 void jrpc_respond(
@@ -67,11 +653,17 @@ void jrpc_respond(
     json_t * result,
     int id)
 {
+    if (!jrpc_connection_complete_request(connection, id))
+    {
+        json_decref(result);
+        return;
+    }
+
     json_t * response = json_object();
     json_object_set_new(response, "result", result);
     json_object_set_new(response, "id", json_integer(id));
 
-    jrpc_connection_send(connection, response);
+    jrpc_connection_deliver(connection, response, id);
 }
 
 void jrpc_respond_error(
@@ -80,28 +672,263 @@ void jrpc_respond_error(
     char const * error_message,
     int id)
 {
-    json_t * error_holder = json_object();
-    json_object_set_new(error_holder, "code", json_integer(error_code));
-    json_object_set_new(error_holder, "message", json_string(error_message));
+    if (jrpc_connection_complete_request(connection, id))
+    {
+        jrpc_connection_deliver(connection, jrpc_connection_create_error(error_code, error_message, id), id);
+    }
+}
 
-    json_t * response = json_object();
-    json_object_set_new(response, "error", error_holder);
-    json_object_set_new(response, "id", json_integer(id));
+void jrpc_notify(
+    struct jrpc_connection * connection,
+    char const * method,
+    json_t * params)
+{
+    struct jrpc_message * message = jrpc_connection_create_notification(&connection->loop->pool, method, params);
+    if (NULL != message)
+    {
+        jrpc_connection_enqueue(connection, message);
+        jrpc_message_dispose(message);
+    }
+}
 
-    jrpc_connection_send(connection, response);
+void jrpc_notify_priority(
+    struct jrpc_connection * connection,
+    char const * method,
+    json_t * params,
+    enum jrpc_priority priority)
+{
+    struct jrpc_message * message = jrpc_connection_create_notification(&connection->loop->pool, method, params);
+    if (NULL != message)
+    {
+        struct jrpc_queue * lane = (JRPC_PRIORITY_HIGH == priority) ?
+            &connection->priority_messages : &connection->messages;
+        jrpc_connection_enqueue_to(connection, lane, message);
+        jrpc_message_dispose(message);
+    }
 }
 
-void jrpc_notify(
+void jrpc_notify_conflated(
     struct jrpc_connection * connection,
+    char const * key,
     char const * method,
     json_t * params)
 {
-    json_t * notification = json_object();
-    json_object_set_new(notification, "method", json_string(method));
-    json_object_set_new(notification, "params", params);
+    struct jrpc_message * message = jrpc_connection_create_notification(&connection->loop->pool, method, params);
+    if (NULL == message)
+    {
+        return;
+    }
+
+    struct jrpc_queue * queue = &connection->messages;
+    struct jrpc_conflation_entry * entry = jrpc_conflation_get(&connection->conflation, key);
+    if ((NULL != entry) && (entry->message == jrpc_queue_get(queue, entry->position)))
+    {
+        // the previous value is not sent yet: the new one takes its place
+        struct jrpc_message * stale = jrpc_queue_replace(queue, entry->position, jrpc_message_ref(message));
+        entry->message = message;
+        connection->conflated_messages++;
+        jrpc_message_dispose(stale);
+    }
+    else
+    {
+        uint64_t const position = jrpc_queue_get_tail(queue);
+        jrpc_connection_enqueue(connection, message);
+        if (message == jrpc_queue_get(queue, position))
+        {
+            jrpc_conflation_set(&connection->conflation, queue, key, position, message);
+        }
+    }
+
+    jrpc_message_dispose(message);
+}
+
+void jrpc_notify_many(
+    struct jrpc_server * server,
+    jrpc_connection_handle const * handles,
+    size_t count,
+    char const * method,
+    json_t * params)
+{
+    if (0 == count)
+    {
+        json_decref(params);
+        return;
+    }
+
+    struct jrpc_protocol * protocol = jrpc_server_get_protocol(server);
+    struct jrpc_loop * loop = jrpc_protocol_get_current_loop(protocol);
+    struct jrpc_message_pool local_pool;
+    struct jrpc_message_pool * pool = jrpc_connection_acquire_pool(loop, &local_pool);
+
+    struct jrpc_message * message = jrpc_connection_create_notification(pool, method, params);
+    if (NULL != message)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            // connections of other loops are only reached by handle through their loop
+            struct jrpc_loop * target = jrpc_protocol_get_loop(protocol, handles[i]);
+            if ((NULL != loop) && (loop == target))
+            {
+                struct jrpc_connection * connection = jrpc_registry_resolve(&loop->registry, handles[i]);
+                if (NULL != connection)
+                {
+                    jrpc_connection_enqueue(connection, message);
+                }
+            }
+            else if (NULL != target)
+            {
+                struct jrpc_post * post = jrpc_post_create_copy(JRPC_POST_MESSAGE, handles[i], message->data, message->length);
+                if (NULL != post)
+                {
+                    jrpc_loop_post(target, post);
+                }
+            }
+        }
+
+        jrpc_message_dispose(message);
+    }
+
+    jrpc_connection_release_pool(pool, &local_pool);
+}
+
+void jrpc_notify_all(
+    struct jrpc_server * server,
+    char const * method,
+    json_t * params)
+{
+    struct jrpc_protocol * protocol = jrpc_server_get_protocol(server);
+    struct jrpc_loop * loop = jrpc_protocol_get_current_loop(protocol);
+    struct jrpc_message_pool local_pool;
+    struct jrpc_message_pool * pool = jrpc_connection_acquire_pool(loop, &local_pool);
+
+    struct jrpc_message * message = jrpc_connection_create_notification(pool, method, params);
+    if (NULL != message)
+    {
+        if (NULL != loop)
+        {
+            jrpc_loop_broadcast(loop, message);
+        }
+
+        // other loops get their own copy, since messages are not shared across threads
+        for(size_t i = 0; i < protocol->loop_count; i++)
+        {
+            struct jrpc_loop * other = &protocol->loops[i];
+            if (loop != other)
+            {
+                struct jrpc_post * post = jrpc_post_create_copy(JRPC_POST_BROADCAST, 0, message->data, message->length);
+                if (NULL != post)
+                {
+                    jrpc_loop_post(other, post);
+                }
+            }
+        }
+
+        jrpc_message_dispose(message);
+    }
+
+    jrpc_connection_release_pool(pool, &local_pool);
+}
+
+bool jrpc_subscribe(
+    struct jrpc_connection * connection,
+    char const * topic)
+{
+    return jrpc_topics_subscribe(&connection->loop->topics, &connection->subscriptions, connection, topic);
+}
+
+void jrpc_unsubscribe(
+    struct jrpc_connection * connection,
+    char const * topic)
+{
+    jrpc_topics_unsubscribe(&connection->loop->topics, &connection->subscriptions, topic);
+}
+
+void jrpc_publish(
+    struct jrpc_server * server,
+    char const * topic,
+    char const * method,
+    json_t * params)
+{
+    struct jrpc_protocol * protocol = jrpc_server_get_protocol(server);
+    struct jrpc_loop * loop = jrpc_protocol_get_current_loop(protocol);
+    struct jrpc_message_pool local_pool;
+    struct jrpc_message_pool * pool = jrpc_connection_acquire_pool(loop, &local_pool);
+
+    struct jrpc_message * message = jrpc_connection_create_notification(pool, method, params);
+    if (NULL != message)
+    {
+        if (NULL != loop)
+        {
+            jrpc_loop_publish(loop, topic, message);
+        }
+
+        for(size_t i = 0; i < protocol->loop_count; i++)
+        {
+            struct jrpc_loop * other = &protocol->loops[i];
+            if (loop != other)
+            {
+                struct jrpc_post * post = jrpc_post_create_copy(JRPC_POST_PUBLISH, 0, message->data, message->length);
+                if (NULL != post)
+                {
+                    post->topic = strdup(topic);
+                    jrpc_loop_post(other, post);
+                }
+            }
+        }
 
-    jrpc_connection_send(connection, notification);
+        jrpc_message_dispose(message);
+    }
+
+    jrpc_connection_release_pool(pool, &local_pool);
+}
+
+size_t jrpc_connection_get_outbound_bytes(
+    struct jrpc_connection * connection)
+{
+    return jrpc_connection_queued_bytes(connection);
+}
 
+size_t jrpc_connection_get_outbound_messages(
+    struct jrpc_connection * connection)
+{
+    return jrpc_connection_queued_messages(connection);
+}
+
+bool jrpc_is_cancelled(
+    struct jrpc_connection * connection,
+    int id)
+{
+    if (!connection->protocol->is_tracking_requests)
+    {
+        return false;
+    }
+
+    struct jrpc_inflight_entry const * entry = jrpc_inflight_find(&connection->inflight, id);
+    return ((NULL == entry) || (entry->is_cancelled));
+}
+
+size_t jrpc_connection_get_pending_requests(
+    struct jrpc_connection * connection)
+{
+    return connection->inflight.count;
+}
+
+size_t jrpc_connection_get_dropped_messages(
+    struct jrpc_connection * connection)
+{
+    return connection->dropped_messages;
+}
+
+size_t jrpc_connection_get_conflated_messages(
+    struct jrpc_connection * connection)
+{
+    return connection->conflated_messages;
+}
+
+bool jrpc_connection_is_congested(
+    struct jrpc_connection * connection)
+{
+    return connection->is_congested;
 }
 
 struct jrpc_server * jrpc_connection_get_server(
@@ -122,3 +949,119 @@ void * jrpc_connection_get_userdata(
 {
     return connection->user_data;
 }
+
+jrpc_connection_id jrpc_connection_get_id(
+    struct jrpc_connection * connection)
+{
+    return (jrpc_connection_id) connection->handle;
+}
+
+struct jrpc_connection * jrpc_server_find_connection(
+    struct jrpc_server * server,
+    jrpc_connection_id id)
+{
+    struct jrpc_protocol * protocol = jrpc_server_get_protocol(server);
+    struct jrpc_loop * loop = jrpc_protocol_get_current_loop(protocol);
+
+    struct jrpc_connection * connection = (NULL != loop) ? jrpc_registry_find(&loop->registry, id) : NULL;
+
+    return ((NULL != connection) && (!connection->is_closing)) ? connection : NULL;
+}
+
+void jrpc_server_foreach_connection(
+    struct jrpc_server * server,
+    jrpc_connection_visit_fn * visit,
+    void * user_data)
+{
+    struct jrpc_protocol * protocol = jrpc_server_get_protocol(server);
+    struct jrpc_loop * loop = jrpc_protocol_get_current_loop(protocol);
+    if (NULL == loop)
+    {
+        return;
+    }
+
+    struct jrpc_registry const * registry = &loop->registry;
+
+    // visitors may close connections, which stay registered until
+    // lws reports them closed, so the active slots do not change
+    for(size_t i = 0; i < registry->active; i++)
+    {
+        struct jrpc_connection * connection = jrpc_registry_get_active(registry, i);
+        if ((!connection->is_closing) && (!visit(connection, user_data)))
+        {
+            break;
+        }
+    }
+}
+
+size_t jrpc_server_get_connection_count(
+    struct jrpc_server * server)
+{
+    struct jrpc_protocol * protocol = jrpc_server_get_protocol(server);
+
+    size_t count = 0;
+    for(size_t i = 0; i < protocol->loop_count; i++)
+    {
+        count += protocol->loops[i].registry.active;
+    }
+
+    return count;
+}
+
+jrpc_connection_handle jrpc_connection_get_handle(
+    struct jrpc_connection * connection)
+{
+    return connection->handle;
+}
+
+struct jrpc_connection * jrpc_server_get_connection(
+    struct jrpc_server * server,
+    jrpc_connection_handle handle)
+{
+    struct jrpc_loop * loop = jrpc_protocol_get_loop(jrpc_server_get_protocol(server), handle);
+
+    return (NULL != loop) ? jrpc_registry_resolve(&loop->registry, handle) : NULL;
+}
+
+void jrpc_respond_threadsafe(
+    struct jrpc_server * server,
+    jrpc_connection_handle handle,
+    json_t * result,
+    int id)
+{
+    struct jrpc_post * post = jrpc_post_create(JRPC_POST_RESPONSE, handle, result, NULL);
+    if (NULL != post)
+    {
+        post->id = id;
+        jrpc_protocol_post(jrpc_server_get_protocol(server), post);
+    }
+}
+
+void jrpc_respond_error_threadsafe(
+    struct jrpc_server * server,
+    jrpc_connection_handle handle,
+    int error_code,
+    char const * error_message,
+    int id)
+{
+    struct jrpc_post * post = jrpc_post_create(JRPC_POST_ERROR, handle, NULL, error_message);
+    if (NULL != post)
+    {
+        post->error_code = error_code;
+        post->id = id;
+        jrpc_protocol_post(jrpc_server_get_protocol(server), post);
+    }
+}
+
+void jrpc_notify_threadsafe(
+    struct jrpc_server * server,
+    jrpc_connection_handle handle,
+    char const * method,
+    json_t * params)
+{
+    struct jrpc_post * post = jrpc_post_create(JRPC_POST_NOTIFICATION, handle, params, method);
+    if (NULL != post)
+    {
+        jrpc_protocol_post(jrpc_server_get_protocol(server), post);
+    }
+}
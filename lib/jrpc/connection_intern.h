@@ -28,15 +28,46 @@
 
 #include "jrpc/connection.h"
 #include "jrpc/queue.h"
+#include "jrpc/conflation.h"
+#include "jrpc/buffer.h"
+#include "jrpc/inflight.h"
+#include "jrpc/topic.h"
+#include "jrpc/timer_wheel.h"
 #include <libwebsockets.h>
 
+#ifndef __cplusplus
+#include <stdbool.h>
+#endif
+
 struct jrpc_server;
+struct jrpc_protocol;
+struct jrpc_loop;
+struct jrpc_message;
+struct jrpc_batch;
 
 struct jrpc_connection
 {
     struct jrpc_server * server;
+    struct jrpc_protocol * protocol;
+    struct jrpc_loop * loop;
     struct lws * wsi;
+    jrpc_connection_handle handle;
     struct jrpc_queue messages;
+    struct jrpc_queue priority_messages;
+    size_t priority_credit;
+    struct jrpc_message * fragmented;
+    size_t fragment_offset;
+    struct jrpc_conflation conflation;
+    struct jrpc_batch * batches;
+    struct jrpc_buffer receive_buffer;
+    struct jrpc_inflight inflight;
+    struct jrpc_subscriptions subscriptions;
+    size_t dropped_messages;
+    size_t conflated_messages;
+    bool is_congested;
+    bool is_closing;
+    bool is_batching;
+    struct jrpc_timer flush_timer;
     void * user_data;
 };
 
@@ -47,13 +78,57 @@ extern "C"
 
 extern void jrpc_connection_init(
     struct jrpc_connection * connection,
-    struct jrpc_server * server,
+    struct jrpc_loop * loop,
     struct lws * wsi
 );
 
 extern void jrpc_connection_cleanup(
     struct jrpc_connection * connection);
 
+extern void jrpc_connection_enqueue(
+    struct jrpc_connection * connection,
+    struct jrpc_message * message);
+
+extern struct jrpc_message * jrpc_connection_dequeue(
+    struct jrpc_connection * connection);
+
+extern struct jrpc_message * jrpc_connection_dequeue_batch(
+    struct jrpc_connection * connection);
+
+extern bool jrpc_connection_has_messages(
+    struct jrpc_connection * connection);
+
+extern bool jrpc_connection_needs_write(
+    struct jrpc_connection * connection);
+
+extern void jrpc_connection_track_request(
+    struct jrpc_connection * connection,
+    int id);
+
+extern void jrpc_connection_cancel_request(
+    struct jrpc_connection * connection,
+    int id);
+
+extern void jrpc_connection_cancel_all(
+    struct jrpc_connection * connection);
+
+extern struct jrpc_batch * jrpc_connection_begin_batch(
+    struct jrpc_connection * connection,
+    int const * ids,
+    size_t count);
+
+extern void jrpc_connection_reject_request(
+    struct jrpc_connection * connection,
+    struct jrpc_batch * batch);
+
+extern void jrpc_connection_reject_duplicate(
+    struct jrpc_connection * connection,
+    int id);
+
+extern void jrpc_connection_end_batch(
+    struct jrpc_connection * connection,
+    struct jrpc_batch * batch);
+
 #ifdef __cplusplus
 }
 #endif
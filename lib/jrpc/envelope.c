@@ -0,0 +1,822 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/envelope.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#define JRPC_ENVELOPE_MAX_DEPTH 2048
+#define JRPC_ENVELOPE_KEY_BUFFER_SIZE 64
+
+struct jrpc_scanner
+{
+    char const * data;
+    size_t length;
+    size_t pos;
+};
+
+static bool jrpc_scanner_skip_value(
+    struct jrpc_scanner * scanner,
+    size_t depth);
+
+static void jrpc_scanner_skip_whitespace(
+    struct jrpc_scanner * scanner)
+{
+    while (scanner->pos < scanner->length)
+    {
+        char const c = scanner->data[scanner->pos];
+        if ((' ' != c) && ('\t' != c) && ('\n' != c) && ('\r' != c))
+        {
+            break;
+        }
+
+        scanner->pos++;
+    }
+}
+
+static bool jrpc_scanner_is_at(
+    struct jrpc_scanner * scanner,
+    char c)
+{
+    return ((scanner->pos < scanner->length) && (c == scanner->data[scanner->pos]));
+}
+
+static bool jrpc_scanner_expect(
+    struct jrpc_scanner * scanner,
+    char c)
+{
+    jrpc_scanner_skip_whitespace(scanner);
+    if (jrpc_scanner_is_at(scanner, c))
+    {
+        scanner->pos++;
+        return true;
+    }
+
+    return false;
+}
+
+static bool jrpc_scanner_is_digit(
+    struct jrpc_scanner * scanner)
+{
+    return ((scanner->pos < scanner->length) &&
+        ('0' <= scanner->data[scanner->pos]) && (scanner->data[scanner->pos] <= '9'));
+}
+
+static int jrpc_hex_value(
+    char c)
+{
+    if (('0' <= c) && (c <= '9'))
+    {
+        return c - '0';
+    }
+    else if (('a' <= c) && (c <= 'f'))
+    {
+        return c - 'a' + 10;
+    }
+    else if (('A' <= c) && (c <= 'F'))
+    {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+static bool jrpc_read_hex4(
+    char const * data,
+    unsigned int * value)
+{
+    *value = 0;
+    for(size_t i = 0; i < 4; i++)
+    {
+        int const digit = jrpc_hex_value(data[i]);
+        if (0 > digit)
+        {
+            return false;
+        }
+
+        *value = (*value << 4) | ((unsigned int) digit);
+    }
+
+    return true;
+}
+
+static size_t jrpc_utf8_sequence_length(
+    char const * data,
+    size_t available)
+{
+    unsigned char const first = (unsigned char) data[0];
+    size_t length;
+    unsigned int codepoint;
+
+    if ((0xc2 <= first) && (first <= 0xdf))
+    {
+        length = 2;
+        codepoint = first & 0x1f;
+    }
+    else if (0xe0 == (first & 0xf0))
+    {
+        length = 3;
+        codepoint = first & 0x0f;
+    }
+    else if ((0xf0 <= first) && (first <= 0xf4))
+    {
+        length = 4;
+        codepoint = first & 0x07;
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (length > available)
+    {
+        return 0;
+    }
+
+    for(size_t i = 1; i < length; i++)
+    {
+        unsigned char const c = (unsigned char) data[i];
+        if (0x80 != (c & 0xc0))
+        {
+            return 0;
+        }
+
+        codepoint = (codepoint << 6) | (c & 0x3f);
+    }
+
+    // reject overlong encodings, surrogates and code points beyond U+10FFFF
+    if (((3 == length) && (0x800 > codepoint)) || ((4 == length) && (0x10000 > codepoint)) ||
+        ((0xd800 <= codepoint) && (codepoint <= 0xdfff)) || (0x10ffff < codepoint))
+    {
+        return 0;
+    }
+
+    return length;
+}
+
+static bool jrpc_scanner_scan_string(
+    struct jrpc_scanner * scanner,
+    char const * * raw,
+    size_t * raw_length)
+{
+    if (!jrpc_scanner_is_at(scanner, '"'))
+    {
+        return false;
+    }
+
+    scanner->pos++;
+    size_t const start = scanner->pos;
+
+    while (scanner->pos < scanner->length)
+    {
+        unsigned char const c = (unsigned char) scanner->data[scanner->pos];
+        if ('"' == c)
+        {
+            *raw = &scanner->data[start];
+            *raw_length = scanner->pos - start;
+            scanner->pos++;
+            return true;
+        }
+        else if ('\\' == c)
+        {
+            scanner->pos++;
+            if (scanner->pos >= scanner->length)
+            {
+                return false;
+            }
+
+            switch (scanner->data[scanner->pos])
+            {
+            case '"':
+                // fall-through
+            case '\\':
+                // fall-through
+            case '/':
+                // fall-through
+            case 'b':
+                // fall-through
+            case 'f':
+                // fall-through
+            case 'n':
+                // fall-through
+            case 'r':
+                // fall-through
+            case 't':
+                scanner->pos++;
+                break;
+            case 'u':
+                {
+                    unsigned int value;
+                    if ((scanner->pos + 5 > scanner->length) ||
+                        (!jrpc_read_hex4(&scanner->data[scanner->pos + 1], &value)) ||
+                        ((0xdc00 <= value) && (value <= 0xdfff)))
+                    {
+                        return false;
+                    }
+                    scanner->pos += 5;
+
+                    // a high surrogate must be followed by a low surrogate
+                    if ((0xd800 <= value) && (value <= 0xdbff))
+                    {
+                        unsigned int low;
+                        if ((scanner->pos + 6 > scanner->length) ||
+                            ('\\' != scanner->data[scanner->pos]) || ('u' != scanner->data[scanner->pos + 1]) ||
+                            (!jrpc_read_hex4(&scanner->data[scanner->pos + 2], &low)) ||
+                            (0xdc00 > low) || (low > 0xdfff))
+                        {
+                            return false;
+                        }
+                        scanner->pos += 6;
+                    }
+                }
+                break;
+            default:
+                return false;
+            }
+        }
+        else if (0x20 > c)
+        {
+            return false;
+        }
+        else if (0x80 <= c)
+        {
+            size_t const length = jrpc_utf8_sequence_length(&scanner->data[scanner->pos], scanner->length - scanner->pos);
+            if (0 == length)
+            {
+                return false;
+            }
+
+            scanner->pos += length;
+        }
+        else
+        {
+            scanner->pos++;
+        }
+    }
+
+    return false;
+}
+
+static bool jrpc_scanner_scan_number(
+    struct jrpc_scanner * scanner,
+    bool * is_integer,
+    long long * value)
+{
+    bool is_negative = false;
+    bool is_overflow = false;
+    unsigned long long magnitude = 0;
+    unsigned long long const limit = ((unsigned long long) LLONG_MAX) + 1;
+
+    if (jrpc_scanner_is_at(scanner, '-'))
+    {
+        is_negative = true;
+        scanner->pos++;
+    }
+
+    if (jrpc_scanner_is_at(scanner, '0'))
+    {
+        scanner->pos++;
+    }
+    else if (jrpc_scanner_is_digit(scanner))
+    {
+        while (jrpc_scanner_is_digit(scanner))
+        {
+            unsigned int const digit = (unsigned int) (scanner->data[scanner->pos] - '0');
+            if (magnitude > (limit - digit) / 10)
+            {
+                is_overflow = true;
+            }
+            else
+            {
+                magnitude = (magnitude * 10) + digit;
+            }
+
+            scanner->pos++;
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    *is_integer = true;
+
+    if (jrpc_scanner_is_at(scanner, '.'))
+    {
+        scanner->pos++;
+        if (!jrpc_scanner_is_digit(scanner))
+        {
+            return false;
+        }
+
+        while (jrpc_scanner_is_digit(scanner))
+        {
+            scanner->pos++;
+        }
+
+        *is_integer = false;
+    }
+
+    if ((jrpc_scanner_is_at(scanner, 'e')) || (jrpc_scanner_is_at(scanner, 'E')))
+    {
+        scanner->pos++;
+        if ((jrpc_scanner_is_at(scanner, '+')) || (jrpc_scanner_is_at(scanner, '-')))
+        {
+            scanner->pos++;
+        }
+
+        if (!jrpc_scanner_is_digit(scanner))
+        {
+            return false;
+        }
+
+        while (jrpc_scanner_is_digit(scanner))
+        {
+            scanner->pos++;
+        }
+
+        *is_integer = false;
+    }
+
+    if (*is_integer)
+    {
+        if ((is_overflow) || ((!is_negative) && (magnitude == limit)))
+        {
+            return false;
+        }
+
+        *value = (is_negative) ? (long long) (0 - magnitude) : (long long) magnitude;
+    }
+
+    return true;
+}
+
+static bool jrpc_scanner_skip_literal(
+    struct jrpc_scanner * scanner,
+    char const * literal)
+{
+    size_t const length = strlen(literal);
+    if ((scanner->pos + length <= scanner->length) &&
+        (0 == memcmp(&scanner->data[scanner->pos], literal, length)))
+    {
+        scanner->pos += length;
+        return true;
+    }
+
+    return false;
+}
+
+static bool jrpc_scanner_skip_container(
+    struct jrpc_scanner * scanner,
+    size_t depth,
+    char end)
+{
+    if (JRPC_ENVELOPE_MAX_DEPTH <= depth)
+    {
+        return false;
+    }
+
+    scanner->pos++;
+    if (jrpc_scanner_expect(scanner, end))
+    {
+        return true;
+    }
+
+    do
+    {
+        if ('}' == end)
+        {
+            char const * key;
+            size_t key_length;
+
+            jrpc_scanner_skip_whitespace(scanner);
+            if ((!jrpc_scanner_scan_string(scanner, &key, &key_length)) ||
+                (!jrpc_scanner_expect(scanner, ':')))
+            {
+                return false;
+            }
+        }
+
+        if (!jrpc_scanner_skip_value(scanner, depth + 1))
+        {
+            return false;
+        }
+    } while (jrpc_scanner_expect(scanner, ','));
+
+    return jrpc_scanner_expect(scanner, end);
+}
+
+static bool jrpc_scanner_skip_value(
+    struct jrpc_scanner * scanner,
+    size_t depth)
+{
+    jrpc_scanner_skip_whitespace(scanner);
+    if (scanner->pos >= scanner->length)
+    {
+        return false;
+    }
+
+    switch (scanner->data[scanner->pos])
+    {
+    case '"':
+        {
+            char const * raw;
+            size_t raw_length;
+            return jrpc_scanner_scan_string(scanner, &raw, &raw_length);
+        }
+    case '{':
+        return jrpc_scanner_skip_container(scanner, depth, '}');
+    case '[':
+        return jrpc_scanner_skip_container(scanner, depth, ']');
+    case 't':
+        return jrpc_scanner_skip_literal(scanner, "true");
+    case 'f':
+        return jrpc_scanner_skip_literal(scanner, "false");
+    case 'n':
+        return jrpc_scanner_skip_literal(scanner, "null");
+    default:
+        {
+            bool is_integer;
+            long long value;
+            return jrpc_scanner_scan_number(scanner, &is_integer, &value);
+        }
+    }
+}
+
+static size_t jrpc_encode_utf8(
+    unsigned int codepoint,
+    char * target)
+{
+    if (0x80 > codepoint)
+    {
+        target[0] = (char) codepoint;
+        return 1;
+    }
+    else if (0x800 > codepoint)
+    {
+        target[0] = (char) (0xc0 | (codepoint >> 6));
+        target[1] = (char) (0x80 | (codepoint & 0x3f));
+        return 2;
+    }
+    else if (0x10000 > codepoint)
+    {
+        target[0] = (char) (0xe0 | (codepoint >> 12));
+        target[1] = (char) (0x80 | ((codepoint >> 6) & 0x3f));
+        target[2] = (char) (0x80 | (codepoint & 0x3f));
+        return 3;
+    }
+    else
+    {
+        target[0] = (char) (0xf0 | (codepoint >> 18));
+        target[1] = (char) (0x80 | ((codepoint >> 12) & 0x3f));
+        target[2] = (char) (0x80 | ((codepoint >> 6) & 0x3f));
+        target[3] = (char) (0x80 | (codepoint & 0x3f));
+        return 4;
+    }
+}
+
+// Decodes a string previously validated by jrpc_scanner_scan_string.
+// The decoded string is never longer than its raw representation.
+static bool jrpc_decode_string(
+    char const * raw,
+    size_t raw_length,
+    char * target)
+{
+    size_t i = 0;
+    size_t n = 0;
+
+    while (i < raw_length)
+    {
+        if ('\\' != raw[i])
+        {
+            target[n++] = raw[i++];
+            continue;
+        }
+
+        char const escaped = raw[i + 1];
+        i += 2;
+
+        switch (escaped)
+        {
+        case 'b':
+            target[n++] = '\b';
+            break;
+        case 'f':
+            target[n++] = '\f';
+            break;
+        case 'n':
+            target[n++] = '\n';
+            break;
+        case 'r':
+            target[n++] = '\r';
+            break;
+        case 't':
+            target[n++] = '\t';
+            break;
+        case 'u':
+            {
+                unsigned int codepoint;
+                jrpc_read_hex4(&raw[i], &codepoint);
+                i += 4;
+
+                if ((0xd800 <= codepoint) && (codepoint <= 0xdbff))
+                {
+                    unsigned int low;
+                    if ((i + 6 > raw_length) || ('\\' != raw[i]) || ('u' != raw[i + 1]) ||
+                        (!jrpc_read_hex4(&raw[i + 2], &low)) || (0xdc00 > low) || (low > 0xdfff))
+                    {
+                        return false;
+                    }
+
+                    codepoint = 0x10000 + ((codepoint - 0xd800) << 10) + (low - 0xdc00);
+                    i += 6;
+                }
+                else if (((0xdc00 <= codepoint) && (codepoint <= 0xdfff)) || (0 == codepoint))
+                {
+                    return false;
+                }
+
+                n += jrpc_encode_utf8(codepoint, &target[n]);
+            }
+            break;
+        default:
+            target[n++] = escaped;
+            break;
+        }
+    }
+
+    target[n] = '\0';
+    return true;
+}
+
+static bool jrpc_key_equals(
+    char const * raw,
+    size_t raw_length,
+    char const * key)
+{
+    size_t const key_length = strlen(key);
+    if (NULL == memchr(raw, '\\', raw_length))
+    {
+        return ((raw_length == key_length) && (0 == memcmp(raw, key, key_length)));
+    }
+
+    char buffer[JRPC_ENVELOPE_KEY_BUFFER_SIZE];
+    return ((raw_length < JRPC_ENVELOPE_KEY_BUFFER_SIZE) &&
+        (jrpc_decode_string(raw, raw_length, buffer)) &&
+        (0 == strcmp(buffer, key)));
+}
+
+static bool jrpc_envelope_set_method(
+    struct jrpc_envelope * envelope,
+    char const * raw,
+    size_t raw_length)
+{
+    char * method = envelope->method_buffer;
+    if (raw_length >= JRPC_ENVELOPE_METHOD_BUFFER_SIZE)
+    {
+        envelope->method_heap = malloc(raw_length + 1);
+        method = envelope->method_heap;
+        if (NULL == method)
+        {
+            return false;
+        }
+    }
+
+    if (!jrpc_decode_string(raw, raw_length, method))
+    {
+        return false;
+    }
+
+    envelope->method = method;
+    return true;
+}
+
+bool jrpc_envelope_parse(
+    struct jrpc_envelope * envelope,
+    char const * data,
+    size_t length)
+{
+    struct jrpc_scanner scanner = { data, length, 0 };
+    char const * method = NULL;
+    size_t method_length = 0;
+    bool is_params_valid = false;
+    bool is_id_in_range = true;
+
+    envelope->method = NULL;
+    envelope->method_heap = NULL;
+    envelope->params = NULL;
+    envelope->params_length = 0;
+    envelope->id = 0;
+    envelope->has_id = false;
+    envelope->has_invalid_id = false;
+
+    if (!jrpc_scanner_expect(&scanner, '{'))
+    {
+        return false;
+    }
+
+    if (!jrpc_scanner_expect(&scanner, '}'))
+    {
+        do
+        {
+            char const * key;
+            size_t key_length;
+
+            jrpc_scanner_skip_whitespace(&scanner);
+            if ((!jrpc_scanner_scan_string(&scanner, &key, &key_length)) ||
+                (!jrpc_scanner_expect(&scanner, ':')))
+            {
+                return false;
+            }
+
+            jrpc_scanner_skip_whitespace(&scanner);
+            size_t const value_start = scanner.pos;
+            bool is_valid;
+
+            if ((jrpc_key_equals(key, key_length, "method")) && (jrpc_scanner_is_at(&scanner, '"')))
+            {
+                is_valid = jrpc_scanner_scan_string(&scanner, &method, &method_length);
+            }
+            else if (jrpc_key_equals(key, key_length, "method"))
+            {
+                method = NULL;
+                is_valid = jrpc_scanner_skip_value(&scanner, 1);
+            }
+            else if (jrpc_key_equals(key, key_length, "params"))
+            {
+                is_params_valid = ((jrpc_scanner_is_at(&scanner, '[')) || (jrpc_scanner_is_at(&scanner, '{')));
+                is_valid = jrpc_scanner_skip_value(&scanner, 1);
+                envelope->params = &data[value_start];
+                envelope->params_length = scanner.pos - value_start;
+            }
+            else if ((jrpc_key_equals(key, key_length, "id")) &&
+                ((jrpc_scanner_is_at(&scanner, '-')) || (jrpc_scanner_is_digit(&scanner))))
+            {
+                long long id = 0;
+                is_valid = jrpc_scanner_scan_number(&scanner, &envelope->has_id, &id);
+                is_id_in_range = ((!envelope->has_id) || ((INT_MIN <= id) && (id <= INT_MAX)));
+                envelope->id = (is_id_in_range) ? (int) id : 0;
+            }
+            else if (jrpc_key_equals(key, key_length, "id"))
+            {
+                envelope->has_id = false;
+                is_id_in_range = true;
+                is_valid = jrpc_scanner_skip_value(&scanner, 1);
+            }
+            else
+            {
+                is_valid = jrpc_scanner_skip_value(&scanner, 1);
+            }
+
+            if (!is_valid)
+            {
+                return false;
+            }
+        } while (jrpc_scanner_expect(&scanner, ','));
+
+        if (!jrpc_scanner_expect(&scanner, '}'))
+        {
+            return false;
+        }
+    }
+
+    jrpc_scanner_skip_whitespace(&scanner);
+    if ((scanner.pos != scanner.length) || (NULL == method) || (!is_params_valid))
+    {
+        return false;
+    }
+
+    if (!is_id_in_range)
+    {
+        // well-formed, but the id cannot be answered: rejected by the caller
+        envelope->has_invalid_id = true;
+        return false;
+    }
+
+    if (!jrpc_envelope_set_method(envelope, method, method_length))
+    {
+        jrpc_envelope_cleanup(envelope);
+        return false;
+    }
+
+    return true;
+}
+
+void jrpc_envelope_cleanup(
+    struct jrpc_envelope * envelope)
+{
+    free(envelope->method_heap);
+    envelope->method_heap = NULL;
+    envelope->method = NULL;
+}
+
+bool jrpc_envelope_is_batch(
+    char const * data,
+    size_t length)
+{
+    struct jrpc_scanner scanner = { data, length, 0 };
+    jrpc_scanner_skip_whitespace(&scanner);
+
+    return jrpc_scanner_is_at(&scanner, '[');
+}
+
+bool jrpc_envelope_parse_batch(
+    char const * data,
+    size_t length,
+    struct jrpc_envelope * * envelopes,
+    size_t * count)
+{
+    struct jrpc_scanner scanner = { data, length, 0 };
+    *envelopes = NULL;
+    *count = 0;
+
+    jrpc_scanner_skip_whitespace(&scanner);
+    if ((!jrpc_scanner_is_at(&scanner, '[')) || (!jrpc_scanner_skip_value(&scanner, 0)))
+    {
+        return false;
+    }
+
+    jrpc_scanner_skip_whitespace(&scanner);
+    if (scanner.pos != scanner.length)
+    {
+        return false;
+    }
+
+    size_t capacity = 0;
+    scanner.pos = 0;
+    jrpc_scanner_expect(&scanner, '[');
+    if (!jrpc_scanner_expect(&scanner, ']'))
+    {
+        do
+        {
+            jrpc_scanner_skip_value(&scanner, 1);
+            capacity++;
+        } while (jrpc_scanner_expect(&scanner, ','));
+    }
+
+    if (0 == capacity)
+    {
+        return true;
+    }
+
+    *envelopes = malloc(capacity * sizeof(struct jrpc_envelope));
+    if (NULL == *envelopes)
+    {
+        return false;
+    }
+
+    scanner.pos = 0;
+    jrpc_scanner_expect(&scanner, '[');
+    for(size_t i = 0; i < capacity; i++)
+    {
+        jrpc_scanner_skip_whitespace(&scanner);
+        size_t const start = scanner.pos;
+        jrpc_scanner_skip_value(&scanner, 1);
+
+        if (!jrpc_envelope_parse(&(*envelopes)[i], &data[start], scanner.pos - start))
+        {
+            (*envelopes)[i].method = NULL;
+        }
+
+        jrpc_scanner_expect(&scanner, ',');
+    }
+
+    *count = capacity;
+    return true;
+}
+
+void jrpc_envelope_cleanup_batch(
+    struct jrpc_envelope * envelopes,
+    size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        jrpc_envelope_cleanup(&envelopes[i]);
+    }
+
+    free(envelopes);
+}
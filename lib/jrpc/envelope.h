@@ -0,0 +1,82 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_ENVELOPE_H
+#define JRPC_ENVELOPE_H
+
+#ifndef __cplusplus
+#include <stddef.h>
+#include <stdbool.h>
+#else
+#include <cstddef>
+using ::std::size_t;
+#endif
+
+#define JRPC_ENVELOPE_METHOD_BUFFER_SIZE 64
+
+struct jrpc_envelope
+{
+    char const * method;
+    char const * params;
+    size_t params_length;
+    int id;
+    bool has_id;
+    bool has_invalid_id;
+    char * method_heap;
+    char method_buffer[JRPC_ENVELOPE_METHOD_BUFFER_SIZE];
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern bool jrpc_envelope_parse(
+    struct jrpc_envelope * envelope,
+    char const * data,
+    size_t length);
+
+extern void jrpc_envelope_cleanup(
+    struct jrpc_envelope * envelope);
+
+extern bool jrpc_envelope_is_batch(
+    char const * data,
+    size_t length);
+
+extern bool jrpc_envelope_parse_batch(
+    char const * data,
+    size_t length,
+    struct jrpc_envelope * * envelopes,
+    size_t * count);
+
+extern void jrpc_envelope_cleanup_batch(
+    struct jrpc_envelope * envelopes,
+    size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
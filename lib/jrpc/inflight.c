@@ -0,0 +1,182 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/inflight.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#define JRPC_INFLIGHT_INITIAL_BUCKETS 16
+
+static size_t jrpc_inflight_bucket(
+    struct jrpc_inflight const * inflight,
+    int id)
+{
+    uint32_t hash = (uint32_t) id;
+    hash ^= hash >> 16;
+    hash *= UINT32_C(0x85ebca6b);
+    hash ^= hash >> 13;
+
+    return hash & (inflight->bucket_count - 1);
+}
+
+static bool jrpc_inflight_grow(
+    struct jrpc_inflight * inflight)
+{
+    size_t const bucket_count = (0 < inflight->bucket_count) ? (2 * inflight->bucket_count) : JRPC_INFLIGHT_INITIAL_BUCKETS;
+    struct jrpc_inflight_entry * * buckets = calloc(bucket_count, sizeof(struct jrpc_inflight_entry *));
+    if (NULL == buckets)
+    {
+        return false;
+    }
+
+    struct jrpc_inflight_entry * * old_buckets = inflight->buckets;
+    size_t const old_bucket_count = inflight->bucket_count;
+
+    inflight->buckets = buckets;
+    inflight->bucket_count = bucket_count;
+
+    for(size_t i = 0; i < old_bucket_count; i++)
+    {
+        struct jrpc_inflight_entry * entry = old_buckets[i];
+        while (NULL != entry)
+        {
+            struct jrpc_inflight_entry * next = entry->next;
+            size_t const bucket = jrpc_inflight_bucket(inflight, entry->id);
+            entry->next = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+
+    free(old_buckets);
+    return true;
+}
+
+void jrpc_inflight_init(
+    struct jrpc_inflight * inflight)
+{
+    inflight->buckets = NULL;
+    inflight->bucket_count = 0;
+    inflight->count = 0;
+}
+
+void jrpc_inflight_cleanup(
+    struct jrpc_inflight * inflight,
+    struct jrpc_timer_wheel * wheel)
+{
+    for(size_t i = 0; i < inflight->bucket_count; i++)
+    {
+        struct jrpc_inflight_entry * entry = inflight->buckets[i];
+        while (NULL != entry)
+        {
+            struct jrpc_inflight_entry * next = entry->next;
+            jrpc_timer_wheel_cancel(wheel, &entry->timer);
+            free(entry);
+            entry = next;
+        }
+    }
+
+    free(inflight->buckets);
+    jrpc_inflight_init(inflight);
+}
+
+struct jrpc_inflight_entry * jrpc_inflight_add(
+    struct jrpc_inflight * inflight,
+    int id)
+{
+    if ((inflight->count >= inflight->bucket_count) && (!jrpc_inflight_grow(inflight)))
+    {
+        return NULL;
+    }
+
+    size_t const bucket = jrpc_inflight_bucket(inflight, id);
+    for(struct jrpc_inflight_entry * entry = inflight->buckets[bucket]; NULL != entry; entry = entry->next)
+    {
+        if (id == entry->id)
+        {
+            // duplicate id: the first request is tracked
+            return NULL;
+        }
+    }
+
+    struct jrpc_inflight_entry * entry = malloc(sizeof(struct jrpc_inflight_entry));
+    if (NULL != entry)
+    {
+        entry->id = id;
+        entry->connection = NULL;
+        entry->is_cancelled = false;
+        entry->next = inflight->buckets[bucket];
+        inflight->buckets[bucket] = entry;
+        inflight->count++;
+    }
+
+    return entry;
+}
+
+struct jrpc_inflight_entry * jrpc_inflight_find(
+    struct jrpc_inflight const * inflight,
+    int id)
+{
+    if (0 == inflight->count)
+    {
+        return NULL;
+    }
+
+    struct jrpc_inflight_entry * entry = inflight->buckets[jrpc_inflight_bucket(inflight, id)];
+    while ((NULL != entry) && (id != entry->id))
+    {
+        entry = entry->next;
+    }
+
+    return entry;
+}
+
+struct jrpc_inflight_entry * jrpc_inflight_remove(
+    struct jrpc_inflight * inflight,
+    int id)
+{
+    if (0 == inflight->count)
+    {
+        return NULL;
+    }
+
+    struct jrpc_inflight_entry * * link = &inflight->buckets[jrpc_inflight_bucket(inflight, id)];
+    while (NULL != *link)
+    {
+        struct jrpc_inflight_entry * entry = *link;
+        if (id == entry->id)
+        {
+            *link = entry->next;
+            entry->next = NULL;
+            inflight->count--;
+            return entry;
+        }
+
+        link = &entry->next;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,85 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_INFLIGHT_H
+#define JRPC_INFLIGHT_H
+
+#include "jrpc/timer_wheel.h"
+
+#ifndef __cplusplus
+#include <stddef.h>
+#include <stdbool.h>
+#else
+#include <cstddef>
+using ::std::size_t;
+#endif
+
+struct jrpc_connection;
+
+struct jrpc_inflight_entry
+{
+    struct jrpc_timer timer;
+    struct jrpc_inflight_entry * next;
+    struct jrpc_connection * connection;
+    int id;
+    bool is_cancelled;
+};
+
+struct jrpc_inflight
+{
+    struct jrpc_inflight_entry * * buckets;
+    size_t bucket_count;
+    size_t count;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern void jrpc_inflight_init(
+    struct jrpc_inflight * inflight);
+
+extern void jrpc_inflight_cleanup(
+    struct jrpc_inflight * inflight,
+    struct jrpc_timer_wheel * wheel);
+
+extern struct jrpc_inflight_entry * jrpc_inflight_add(
+    struct jrpc_inflight * inflight,
+    int id);
+
+extern struct jrpc_inflight_entry * jrpc_inflight_find(
+    struct jrpc_inflight const * inflight,
+    int id);
+
+extern struct jrpc_inflight_entry * jrpc_inflight_remove(
+    struct jrpc_inflight * inflight,
+    int id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
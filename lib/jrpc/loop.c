@@ -0,0 +1,363 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include "jrpc/loop.h"
+#include "jrpc/connection_intern.h"
+#include "jrpc/post.h"
+#include "jrpc/loop_timer.h"
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define JRPC_LOOP_MAX_POSTS_PER_WAKEUP 1024
+#define JRPC_LOOP_TIMEOUT_MS (1 * 1000)
+#define JRPC_LOOP_LOCAL_SUBSCRIBERS 64
+
+static _Thread_local struct jrpc_loop * jrpc_loop_current_loop = NULL;
+
+static void jrpc_loop_arm_timer(
+    struct jrpc_loop * loop,
+    uint64_t now,
+    uint64_t deadline)
+{
+    // the deadline is also reported to external event loops by jrpc_server_get_timeout
+    loop->timer_deadline = deadline;
+    if (NULL != loop->wakeup_wsi)
+    {
+        uint64_t const timeout_ms = (deadline > now) ? (deadline - now) : 1;
+        lws_set_timer_usecs(loop->wakeup_wsi, (long long) (timeout_ms * 1000));
+    }
+}
+
+static void * jrpc_loop_run(
+    void * arg)
+{
+    struct jrpc_loop * loop = arg;
+
+    while (!atomic_load(&loop->is_stopping))
+    {
+        jrpc_loop_service(loop, JRPC_LOOP_TIMEOUT_MS);
+    }
+
+    return NULL;
+}
+
+void jrpc_loop_init(
+    struct jrpc_loop * loop,
+    struct jrpc_protocol * protocol,
+    size_t index)
+{
+    memset(loop->ws_protocols, 0, sizeof(struct lws_protocols) * JRPC_LOOP_PROTOCOL_COUNT);
+    memset(&loop->mount, 0, sizeof(struct lws_http_mount));
+    memset(&loop->info, 0, sizeof(struct lws_context_creation_info));
+    memset(&loop->write_stats, 0, sizeof(struct jrpc_write_stats));
+    jrpc_timer_wheel_init(&loop->timers, jrpc_loop_now_ms());
+    jrpc_registry_init(&loop->timer_registry, (uint32_t) index);
+    loop->timer_deadline = 0;
+    loop->pending_requests = 0;
+    loop->fragment_buffer = NULL;
+    loop->wakeup_wsi = NULL;
+
+    loop->protocol = protocol;
+    loop->index = index;
+    loop->context = NULL;
+    jrpc_message_pool_init(&loop->pool);
+    jrpc_registry_init(&loop->registry, (uint32_t) index);
+    jrpc_topics_init(&loop->topics);
+    jrpc_mpsc_queue_init(&loop->posts);
+    loop->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    atomic_init(&loop->is_signalled, false);
+    atomic_init(&loop->is_stopping, false);
+    loop->has_thread = false;
+}
+
+void jrpc_loop_cleanup(
+    struct jrpc_loop * loop)
+{
+    jrpc_loop_stop(loop);
+
+    if (NULL != loop->context)
+    {
+        lws_context_destroy(loop->context);
+        loop->context = NULL;
+    }
+
+    close(loop->wakeup_fd);
+
+    struct jrpc_mpsc_node * node = jrpc_mpsc_queue_pop(&loop->posts);
+    while (NULL != node)
+    {
+        jrpc_post_dispose((struct jrpc_post *) node);
+        node = jrpc_mpsc_queue_pop(&loop->posts);
+    }
+
+    jrpc_loop_timer_cancel_all(loop);
+    jrpc_registry_cleanup(&loop->timer_registry);
+    jrpc_registry_cleanup(&loop->registry);
+    jrpc_topics_cleanup(&loop->topics);
+    jrpc_message_pool_cleanup(&loop->pool);
+    free(loop->fragment_buffer);
+}
+
+struct jrpc_loop * jrpc_loop_current(void)
+{
+    return jrpc_loop_current_loop;
+}
+
+void jrpc_loop_attach(
+    struct jrpc_loop * loop)
+{
+    jrpc_loop_current_loop = loop;
+}
+
+void jrpc_loop_service(
+    struct jrpc_loop * loop,
+    int timeout_ms)
+{
+    jrpc_loop_current_loop = loop;
+    lws_service(loop->context, timeout_ms);
+}
+
+void jrpc_loop_service_fd(
+    struct jrpc_loop * loop,
+    int fd,
+    int revents)
+{
+    struct lws_pollfd pollfd;
+    pollfd.fd = fd;
+    pollfd.events = (short) revents;
+    pollfd.revents = (short) revents;
+
+    jrpc_loop_current_loop = loop;
+    lws_service_fd(loop->context, &pollfd);
+}
+
+void jrpc_loop_service_timers(
+    struct jrpc_loop * loop)
+{
+    jrpc_loop_current_loop = loop;
+    lws_service_fd(loop->context, NULL);
+
+    // the lws timer of the wakeup descriptor is only run by lws_service, so
+    // the loop's timers are processed directly
+    jrpc_loop_process_timers(loop);
+
+    // data buffered inside lws (e.g. TLS) is not reported by any fd
+    if (0 == lws_service_adjust_timeout(loop->context, 1, 0))
+    {
+        lws_service_tsi(loop->context, -1, 0);
+    }
+}
+
+bool jrpc_loop_start(
+    struct jrpc_loop * loop,
+    int cpu)
+{
+    atomic_store(&loop->is_stopping, false);
+    if (0 != pthread_create(&loop->thread, NULL, &jrpc_loop_run, loop))
+    {
+        return false;
+    }
+
+    loop->has_thread = true;
+
+    if (0 <= cpu)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        pthread_setaffinity_np(loop->thread, sizeof(cpu_set_t), &cpus);
+    }
+
+    return true;
+}
+
+void jrpc_loop_stop(
+    struct jrpc_loop * loop)
+{
+    if (loop->has_thread)
+    {
+        atomic_store(&loop->is_stopping, true);
+        jrpc_loop_wakeup(loop);
+        pthread_join(loop->thread, NULL);
+        loop->has_thread = false;
+    }
+}
+
+uint64_t jrpc_loop_now_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (((uint64_t) now.tv_sec) * 1000) + (((uint64_t) now.tv_nsec) / (1000 * 1000));
+}
+
+void jrpc_loop_add_timer(
+    struct jrpc_loop * loop,
+    struct jrpc_timer * timer,
+    uint64_t timeout_ms)
+{
+    uint64_t const now = jrpc_loop_now_ms();
+    if (0 == loop->timers.count)
+    {
+        jrpc_timer_wheel_advance(&loop->timers, now);
+    }
+
+    uint64_t const deadline = now + timeout_ms;
+    jrpc_timer_wheel_add(&loop->timers, timer, deadline);
+
+    // only re-arm, if the new timer is due before the armed one
+    if ((0 == loop->timer_deadline) || (deadline < loop->timer_deadline))
+    {
+        jrpc_loop_arm_timer(loop, now, deadline);
+    }
+}
+
+void jrpc_loop_cancel_timer(
+    struct jrpc_loop * loop,
+    struct jrpc_timer * timer)
+{
+    jrpc_timer_wheel_cancel(&loop->timers, timer);
+}
+
+void jrpc_loop_process_timers(
+    struct jrpc_loop * loop)
+{
+    loop->timer_deadline = 0;
+    jrpc_timer_wheel_advance(&loop->timers, jrpc_loop_now_ms());
+
+    // callbacks may have added timers and armed the lws timer already
+    int64_t const next = jrpc_timer_wheel_next_timeout(&loop->timers);
+    if (0 < next)
+    {
+        uint64_t const now = jrpc_loop_now_ms();
+        uint64_t const deadline = loop->timers.current + (uint64_t) next;
+        if ((0 == loop->timer_deadline) || (deadline < loop->timer_deadline))
+        {
+            jrpc_loop_arm_timer(loop, now, deadline);
+        }
+    }
+}
+
+void jrpc_loop_wakeup(
+    struct jrpc_loop * loop)
+{
+    // concurrent wakeups collapse into a single write until the loop drained
+    if (!atomic_exchange(&loop->is_signalled, true))
+    {
+        uint64_t value = 1;
+        write(loop->wakeup_fd, &value, sizeof(value));
+    }
+}
+
+void jrpc_loop_post(
+    struct jrpc_loop * loop,
+    struct jrpc_post * post)
+{
+    jrpc_mpsc_queue_push(&loop->posts, &post->node);
+    jrpc_loop_wakeup(loop);
+}
+
+void jrpc_loop_process_posts(
+    struct jrpc_loop * loop)
+{
+    uint64_t value;
+    read(loop->wakeup_fd, &value, sizeof(value)); /* Flawfinder: ignore */
+
+    // reset before draining: posts pushed from now on signal again
+    atomic_store(&loop->is_signalled, false);
+
+    size_t count = 0;
+    struct jrpc_mpsc_node * node = jrpc_mpsc_queue_pop(&loop->posts);
+    while (NULL != node)
+    {
+        jrpc_post_execute((struct jrpc_post *) node, loop);
+        count++;
+
+        if (JRPC_LOOP_MAX_POSTS_PER_WAKEUP <= count)
+        {
+            // give other events a chance; remaining posts are processed on next wakeup
+            jrpc_loop_wakeup(loop);
+            break;
+        }
+
+        node = jrpc_mpsc_queue_pop(&loop->posts);
+    }
+}
+
+void jrpc_loop_broadcast(
+    struct jrpc_loop * loop,
+    struct jrpc_message * message)
+{
+    for(size_t i = 0; i < loop->registry.active; i++)
+    {
+        jrpc_connection_enqueue(jrpc_registry_get_active(&loop->registry, i), message);
+    }
+}
+
+void jrpc_loop_publish(
+    struct jrpc_loop * loop,
+    char const * topic,
+    struct jrpc_message * message)
+{
+    struct jrpc_topic const * target = jrpc_topics_get(&loop->topics, topic);
+    if (NULL == target)
+    {
+        return;
+    }
+
+    // watermark handlers run within jrpc_connection_enqueue and may (un)subscribe,
+    // which reorders, reallocates or frees the subscribers of the topic
+    size_t const count = target->count;
+    struct jrpc_connection * local_subscribers[JRPC_LOOP_LOCAL_SUBSCRIBERS];
+    struct jrpc_connection * * subscribers = (count <= JRPC_LOOP_LOCAL_SUBSCRIBERS) ?
+        local_subscribers : malloc(count * sizeof(struct jrpc_connection *));
+    if (NULL == subscribers)
+    {
+        return;
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        subscribers[i] = target->subscribers[i].connection;
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        jrpc_connection_enqueue(subscribers[i], message);
+    }
+
+    if (local_subscribers != subscribers)
+    {
+        free(subscribers);
+    }
+}
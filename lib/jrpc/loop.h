@@ -0,0 +1,152 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_LOOP_H
+#define JRPC_LOOP_H
+
+#include "jrpc/server.h"
+#include "jrpc/message_pool.h"
+#include "jrpc/mpsc_queue.h"
+#include "jrpc/registry.h"
+#include "jrpc/timer_wheel.h"
+#include "jrpc/topic.h"
+#include <libwebsockets.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#ifndef __cplusplus
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#endif
+
+#define JRPC_LOOP_PROTOCOL_COUNT 4
+
+struct jrpc_protocol;
+struct jrpc_connection;
+struct jrpc_message;
+struct jrpc_post;
+
+struct jrpc_loop
+{
+    struct jrpc_protocol * protocol;
+    size_t index;
+    struct lws_protocols ws_protocols[JRPC_LOOP_PROTOCOL_COUNT];
+    struct lws_http_mount mount;
+    struct lws_context_creation_info info;
+    struct lws_context * context;
+    struct jrpc_message_pool pool;
+    struct jrpc_registry registry;
+    struct jrpc_topics topics;
+    struct jrpc_mpsc_queue posts;
+    struct jrpc_write_stats write_stats;
+    struct jrpc_timer_wheel timers;
+    struct jrpc_registry timer_registry;
+    uint64_t timer_deadline;
+    size_t pending_requests;
+    unsigned char * fragment_buffer;
+    struct lws * wakeup_wsi;
+    int wakeup_fd;
+    atomic_bool is_signalled;
+    atomic_bool is_stopping;
+    pthread_t thread;
+    bool has_thread;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern void jrpc_loop_init(
+    struct jrpc_loop * loop,
+    struct jrpc_protocol * protocol,
+    size_t index);
+
+extern void jrpc_loop_cleanup(
+    struct jrpc_loop * loop);
+
+extern struct jrpc_loop * jrpc_loop_current(void);
+
+extern void jrpc_loop_attach(
+    struct jrpc_loop * loop);
+
+extern void jrpc_loop_service(
+    struct jrpc_loop * loop,
+    int timeout_ms);
+
+extern void jrpc_loop_service_fd(
+    struct jrpc_loop * loop,
+    int fd,
+    int revents);
+
+extern void jrpc_loop_service_timers(
+    struct jrpc_loop * loop);
+
+extern bool jrpc_loop_start(
+    struct jrpc_loop * loop,
+    int cpu);
+
+extern void jrpc_loop_stop(
+    struct jrpc_loop * loop);
+
+extern uint64_t jrpc_loop_now_ms(void);
+
+extern void jrpc_loop_add_timer(
+    struct jrpc_loop * loop,
+    struct jrpc_timer * timer,
+    uint64_t timeout_ms);
+
+extern void jrpc_loop_cancel_timer(
+    struct jrpc_loop * loop,
+    struct jrpc_timer * timer);
+
+extern void jrpc_loop_process_timers(
+    struct jrpc_loop * loop);
+
+extern void jrpc_loop_wakeup(
+    struct jrpc_loop * loop);
+
+extern void jrpc_loop_post(
+    struct jrpc_loop * loop,
+    struct jrpc_post * post);
+
+extern void jrpc_loop_process_posts(
+    struct jrpc_loop * loop);
+
+extern void jrpc_loop_broadcast(
+    struct jrpc_loop * loop,
+    struct jrpc_message * message);
+
+extern void jrpc_loop_publish(
+    struct jrpc_loop * loop,
+    char const * topic,
+    struct jrpc_message * message);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/loop_timer.h"
+#include "jrpc/loop.h"
+#include "jrpc/protocol.h"
+
+#include <stdlib.h>
+
+static void jrpc_loop_timer_fire(
+    struct jrpc_timer * timer)
+{
+    struct jrpc_loop_timer * loop_timer = (struct jrpc_loop_timer *) timer;
+    struct jrpc_loop * loop = loop_timer->loop;
+    jrpc_timer_id const id = loop_timer->id;
+    jrpc_timer_fn * handler = loop_timer->handler;
+    void * user_data = loop_timer->user_data;
+    unsigned int const interval_ms = loop_timer->interval_ms;
+
+    if (0 == interval_ms)
+    {
+        jrpc_registry_remove(&loop->timer_registry, id);
+        free(loop_timer);
+    }
+
+    handler(loop->protocol->server, id, user_data);
+
+    // the handler may have cancelled a periodic timer
+    if ((0 < interval_ms) && (loop_timer == jrpc_registry_resolve(&loop->timer_registry, id)))
+    {
+        jrpc_loop_add_timer(loop, &loop_timer->timer, interval_ms);
+    }
+}
+
+jrpc_timer_id jrpc_loop_timer_add(
+    struct jrpc_loop * loop,
+    unsigned int timeout_ms,
+    unsigned int interval_ms,
+    jrpc_timer_fn * handler,
+    void * user_data)
+{
+    struct jrpc_loop_timer * loop_timer = malloc(sizeof(struct jrpc_loop_timer));
+    if (NULL == loop_timer)
+    {
+        return 0;
+    }
+
+    loop_timer->id = jrpc_registry_add(&loop->timer_registry, loop_timer);
+    if (0 == loop_timer->id)
+    {
+        free(loop_timer);
+        return 0;
+    }
+
+    jrpc_timer_init(&loop_timer->timer, &jrpc_loop_timer_fire);
+    loop_timer->loop = loop;
+    loop_timer->handler = handler;
+    loop_timer->user_data = user_data;
+    loop_timer->interval_ms = interval_ms;
+
+    jrpc_loop_add_timer(loop, &loop_timer->timer, timeout_ms);
+
+    return loop_timer->id;
+}
+
+void jrpc_loop_timer_cancel(
+    struct jrpc_loop * loop,
+    jrpc_timer_id id)
+{
+    struct jrpc_loop_timer * loop_timer = jrpc_registry_resolve(&loop->timer_registry, id);
+    if (NULL != loop_timer)
+    {
+        jrpc_loop_cancel_timer(loop, &loop_timer->timer);
+        jrpc_registry_remove(&loop->timer_registry, id);
+        free(loop_timer);
+    }
+}
+
+void jrpc_loop_timer_cancel_all(
+    struct jrpc_loop * loop)
+{
+    // cancelling removes the timer from the active slots
+    while (0 < loop->timer_registry.active)
+    {
+        struct jrpc_loop_timer * loop_timer = jrpc_registry_get_active(&loop->timer_registry, 0);
+        jrpc_loop_timer_cancel(loop, loop_timer->id);
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_LOOP_TIMER_H
+#define JRPC_LOOP_TIMER_H
+
+#include "jrpc/server.h"
+#include "jrpc/timer_wheel.h"
+
+struct jrpc_loop;
+
+struct jrpc_loop_timer
+{
+    struct jrpc_timer timer;
+    struct jrpc_loop * loop;
+    jrpc_timer_id id;
+    jrpc_timer_fn * handler;
+    void * user_data;
+    unsigned int interval_ms;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern jrpc_timer_id jrpc_loop_timer_add(
+    struct jrpc_loop * loop,
+    unsigned int timeout_ms,
+    unsigned int interval_ms,
+    jrpc_timer_fn * handler,
+    void * user_data);
+
+extern void jrpc_loop_timer_cancel(
+    struct jrpc_loop * loop,
+    jrpc_timer_id id);
+
+extern void jrpc_loop_timer_cancel_all(
+    struct jrpc_loop * loop);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
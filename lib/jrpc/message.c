@@ -24,43 +24,111 @@
  */
 
 #include "jrpc/message.h"
+#include "jrpc/message_pool.h"
 
-#include <libwebsockets.h>
-#include <stdlib.h>
+#include <string.h>
 
-static size_t jrpc_message_measure(
-    json_t * value)
+struct jrpc_message_writer
 {
-    return json_dumpb(value, NULL, 0, JSON_COMPACT);
-}
+    struct jrpc_message * message;
+};
 
-static void jrpc_message_serialize(
-    struct jrpc_message * message,
-    json_t * value)
+static int jrpc_message_write(
+    char const * buffer,
+    size_t size,
+    void * user_data)
 {
-    json_dumpb(value, message->data, message->length, JSON_COMPACT);
+    struct jrpc_message_writer * writer = user_data;
+    struct jrpc_message * message = writer->message;
+    size_t const required = message->length + size;
+
+    if (required > message->capacity)
+    {
+        size_t capacity = message->capacity;
+        while (capacity < required)
+        {
+            capacity *= 2;
+        }
+
+        struct jrpc_message * grown = jrpc_message_pool_acquire(message->pool, capacity);
+        if (NULL == grown)
+        {
+            return -1;
+        }
+
+        memcpy(grown->data, message->data, message->length);
+        grown->length = message->length;
+        grown->refcount = message->refcount;
+        grown->type = message->type;
+        grown->next = NULL;
+
+        jrpc_message_pool_release(message->pool, message);
+        message = grown;
+        writer->message = message;
+    }
+
+    memcpy(&message->data[message->length], buffer, size);
+    message->length += size;
+
+    return 0;
 }
 
 struct jrpc_message * jrpc_message_create(
+    struct jrpc_message_pool * pool,
     json_t * value)
 {
-    size_t message_size = jrpc_message_measure(value);
-    char * data = malloc(sizeof(struct jrpc_message) + LWS_PRE + message_size);
-    struct jrpc_message * message = (struct jrpc_message * ) data;
+    struct jrpc_message_writer writer;
+    writer.message = jrpc_message_pool_acquire(pool, JRPC_MESSAGE_POOL_MIN_CAPACITY);
+    if (NULL != writer.message)
+    {
+        writer.message->length = 0;
+        writer.message->refcount = 1;
+        writer.message->type = JRPC_MESSAGE_RESPONSE;
+        writer.message->next = NULL;
+
+        int const rc = json_dump_callback(value, &jrpc_message_write, &writer, JSON_COMPACT);
+        if (0 != rc)
+        {
+            jrpc_message_dispose(writer.message);
+            writer.message = NULL;
+        }
+    }
+
+    return writer.message;
+}
+
+struct jrpc_message * jrpc_message_create_copy(
+    struct jrpc_message_pool * pool,
+    char const * data,
+    size_t length,
+    enum jrpc_message_type type)
+{
+    struct jrpc_message * message = jrpc_message_pool_acquire(pool, length);
     if (NULL != message)
     {
-        message->data = &data[sizeof(struct jrpc_message) + LWS_PRE];
-        message->length = message_size;
+        memcpy(message->data, data, length);
+        message->length = length;
+        message->refcount = 1;
+        message->type = type;
         message->next = NULL;
-
-        jrpc_message_serialize(message, value);
     }
 
     return message;
 }
 
+struct jrpc_message * jrpc_message_ref(
+    struct jrpc_message * message)
+{
+    message->refcount++;
+    return message;
+}
+
 void jrpc_message_dispose(
     struct jrpc_message * message)
 {
-    free(message);
+    message->refcount--;
+    if (0 == message->refcount)
+    {
+        jrpc_message_pool_release(message->pool, message);
+    }
 }
@@ -35,11 +35,23 @@
 using ::std::size_t;
 #endif
 
+struct jrpc_message_pool;
+
+enum jrpc_message_type
+{
+    JRPC_MESSAGE_RESPONSE,
+    JRPC_MESSAGE_NOTIFICATION
+};
+
 struct jrpc_message
 {
     struct jrpc_message * next;
+    struct jrpc_message_pool * pool;
+    enum jrpc_message_type type;
     char * data;
     size_t length;
+    size_t capacity;
+    size_t refcount;
 };
 
 #ifdef __cplusplus
@@ -48,8 +60,18 @@ extern "C"
 #endif
 
 extern struct jrpc_message * jrpc_message_create(
+    struct jrpc_message_pool * pool,
     json_t * value);
 
+extern struct jrpc_message * jrpc_message_create_copy(
+    struct jrpc_message_pool * pool,
+    char const * data,
+    size_t length,
+    enum jrpc_message_type type);
+
+extern struct jrpc_message * jrpc_message_ref(
+    struct jrpc_message * message);
+
 extern void jrpc_message_dispose(
     struct jrpc_message * message);
 
@@ -0,0 +1,178 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/message_pool.h"
+#include "jrpc/message.h"
+#include "jrpc/server.h"
+
+#include <libwebsockets.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#define JRPC_MESSAGE_POOL_DEFAULT_MAX_MESSAGES_PER_CLASS 64
+#define JRPC_MESSAGE_POOL_DEFAULT_MAX_BYTES (4 * 1024 * 1024)
+
+static size_t jrpc_message_pool_allocation_size(
+    size_t capacity)
+{
+    return sizeof(struct jrpc_message) + LWS_PRE + capacity;
+}
+
+static bool jrpc_message_pool_get_class(
+    size_t capacity,
+    size_t * size_class)
+{
+    size_t class_capacity = JRPC_MESSAGE_POOL_MIN_CAPACITY;
+    for(size_t i = 0; i < JRPC_MESSAGE_POOL_CLASS_COUNT; i++)
+    {
+        if (capacity <= class_capacity)
+        {
+            *size_class = i;
+            return true;
+        }
+
+        class_capacity *= 2;
+    }
+
+    return false;
+}
+
+void jrpc_message_pool_init(
+    struct jrpc_message_pool * pool)
+{
+    for(size_t i = 0; i < JRPC_MESSAGE_POOL_CLASS_COUNT; i++)
+    {
+        pool->free_messages[i] = NULL;
+        pool->free_count[i] = 0;
+    }
+
+    pool->max_messages_per_class = JRPC_MESSAGE_POOL_DEFAULT_MAX_MESSAGES_PER_CLASS;
+    pool->max_bytes = JRPC_MESSAGE_POOL_DEFAULT_MAX_BYTES;
+    pool->bytes_retained = 0;
+    pool->messages_retained = 0;
+    pool->hits = 0;
+    pool->misses = 0;
+}
+
+void jrpc_message_pool_cleanup(
+    struct jrpc_message_pool * pool)
+{
+    for(size_t i = 0; i < JRPC_MESSAGE_POOL_CLASS_COUNT; i++)
+    {
+        struct jrpc_message * message = pool->free_messages[i];
+        while (NULL != message)
+        {
+            struct jrpc_message * next = message->next;
+            free(message);
+            message = next;
+        }
+
+        pool->free_messages[i] = NULL;
+        pool->free_count[i] = 0;
+    }
+
+    pool->bytes_retained = 0;
+    pool->messages_retained = 0;
+}
+
+void jrpc_message_pool_set_limits(
+    struct jrpc_message_pool * pool,
+    size_t max_messages_per_class,
+    size_t max_bytes)
+{
+    pool->max_messages_per_class = max_messages_per_class;
+    pool->max_bytes = max_bytes;
+}
+
+void jrpc_message_pool_get_stats(
+    struct jrpc_message_pool * pool,
+    struct jrpc_message_pool_stats * stats)
+{
+    stats->hits = pool->hits;
+    stats->misses = pool->misses;
+    stats->bytes_retained = pool->bytes_retained;
+    stats->messages_retained = pool->messages_retained;
+}
+
+struct jrpc_message * jrpc_message_pool_acquire(
+    struct jrpc_message_pool * pool,
+    size_t capacity)
+{
+    size_t size_class;
+    bool const is_pooled = jrpc_message_pool_get_class(capacity, &size_class);
+    if (is_pooled)
+    {
+        capacity = ((size_t) JRPC_MESSAGE_POOL_MIN_CAPACITY) << size_class;
+
+        struct jrpc_message * message = pool->free_messages[size_class];
+        if (NULL != message)
+        {
+            pool->free_messages[size_class] = message->next;
+            pool->free_count[size_class]--;
+            pool->messages_retained--;
+            pool->bytes_retained -= jrpc_message_pool_allocation_size(capacity);
+            pool->hits++;
+
+            return message;
+        }
+    }
+
+    pool->misses++;
+
+    char * data = malloc(jrpc_message_pool_allocation_size(capacity));
+    struct jrpc_message * message = (struct jrpc_message *) data;
+    if (NULL != message)
+    {
+        message->data = &data[sizeof(struct jrpc_message) + LWS_PRE];
+        message->capacity = capacity;
+        message->pool = pool;
+    }
+
+    return message;
+}
+
+void jrpc_message_pool_release(
+    struct jrpc_message_pool * pool,
+    struct jrpc_message * message)
+{
+    size_t size_class;
+    size_t const allocation_size = jrpc_message_pool_allocation_size(message->capacity);
+    bool const is_pooled = jrpc_message_pool_get_class(message->capacity, &size_class);
+
+    if ((is_pooled) &&
+        (pool->free_count[size_class] < pool->max_messages_per_class) &&
+        (pool->bytes_retained + allocation_size <= pool->max_bytes))
+    {
+        message->next = pool->free_messages[size_class];
+        pool->free_messages[size_class] = message;
+        pool->free_count[size_class]++;
+        pool->messages_retained++;
+        pool->bytes_retained += allocation_size;
+    }
+    else
+    {
+        free(message);
+    }
+}
@@ -0,0 +1,384 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/method_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define JRPC_METHOD_TABLE_INITIAL_CAPACITY 16
+#define JRPC_METHOD_TABLE_MAX_DISPLACEMENT (1 << 20)
+#define JRPC_METHOD_TABLE_EMPTY_SLOT (-1)
+
+struct jrpc_method_bucket
+{
+    size_t index;
+    size_t size;
+    size_t start;
+};
+
+static uint32_t jrpc_method_table_hash(
+    char const * name)
+{
+    uint32_t hash = 0x811c9dc5;
+    for(; '\0' != *name; name++)
+    {
+        hash = (hash ^ ((uint8_t) *name)) * 0x01000193;
+    }
+
+    return hash;
+}
+
+static uint32_t jrpc_method_table_displace(
+    uint32_t hash,
+    int32_t displacement)
+{
+    hash ^= ((uint32_t) displacement) * 0x9e3779b9;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+static int jrpc_method_bucket_compare(
+    void const * lhs,
+    void const * rhs)
+{
+    struct jrpc_method_bucket const * left = lhs;
+    struct jrpc_method_bucket const * right = rhs;
+
+    return (left->size < right->size) - (left->size > right->size);
+}
+
+static void jrpc_method_table_reset_slots(
+    struct jrpc_method_table * table)
+{
+    free(table->slots);
+    free(table->displacements);
+    table->slots = NULL;
+    table->displacements = NULL;
+    table->slot_count = 0;
+    table->is_frozen = false;
+}
+
+static bool jrpc_method_table_rehash(
+    struct jrpc_method_table * table)
+{
+    size_t slot_count = JRPC_METHOD_TABLE_INITIAL_CAPACITY;
+    while (slot_count < (2 * table->count))
+    {
+        slot_count *= 2;
+    }
+
+    int32_t * slots = malloc(slot_count * sizeof(int32_t));
+    if (NULL == slots)
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < slot_count; i++)
+    {
+        slots[i] = JRPC_METHOD_TABLE_EMPTY_SLOT;
+    }
+
+    for(size_t i = 0; i < table->count; i++)
+    {
+        size_t slot = table->entries[i].hash & (slot_count - 1);
+        while (JRPC_METHOD_TABLE_EMPTY_SLOT != slots[slot])
+        {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+
+        slots[slot] = (int32_t) i;
+    }
+
+    jrpc_method_table_reset_slots(table);
+    table->slots = slots;
+    table->slot_count = slot_count;
+
+    return true;
+}
+
+static bool jrpc_method_table_place_bucket(
+    struct jrpc_method_table const * table,
+    size_t const * order,
+    struct jrpc_method_bucket const * bucket,
+    int32_t displacement,
+    int32_t * slots)
+{
+    for(size_t i = 0; i < bucket->size; i++)
+    {
+        size_t const entry = order[bucket->start + i];
+        size_t const slot = jrpc_method_table_displace(table->entries[entry].hash, displacement) % table->count;
+        if (JRPC_METHOD_TABLE_EMPTY_SLOT != slots[slot])
+        {
+            for(size_t j = 0; j < i; j++)
+            {
+                size_t const placed = order[bucket->start + j];
+                slots[jrpc_method_table_displace(table->entries[placed].hash, displacement) % table->count] = JRPC_METHOD_TABLE_EMPTY_SLOT;
+            }
+
+            return false;
+        }
+
+        slots[slot] = (int32_t) entry;
+    }
+
+    return true;
+}
+
+static bool jrpc_method_table_build_perfect(
+    struct jrpc_method_table const * table,
+    struct jrpc_method_bucket * buckets,
+    size_t * order,
+    int32_t * slots,
+    int32_t * displacements)
+{
+    size_t const count = table->count;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        buckets[i].index = i;
+        buckets[i].size = 0;
+        slots[i] = JRPC_METHOD_TABLE_EMPTY_SLOT;
+        displacements[i] = 0;
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        buckets[table->entries[i].hash % count].size++;
+    }
+
+    size_t start = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        buckets[i].start = start;
+        start += buckets[i].size;
+        buckets[i].size = 0;
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        struct jrpc_method_bucket * bucket = &buckets[table->entries[i].hash % count];
+        order[bucket->start + bucket->size] = i;
+        bucket->size++;
+    }
+
+    qsort(buckets, count, sizeof(struct jrpc_method_bucket), &jrpc_method_bucket_compare);
+
+    size_t i = 0;
+    for(; (i < count) && (1 < buckets[i].size); i++)
+    {
+        int32_t displacement = 1;
+        while (!jrpc_method_table_place_bucket(table, order, &buckets[i], displacement, slots))
+        {
+            displacement++;
+            if (JRPC_METHOD_TABLE_MAX_DISPLACEMENT < displacement)
+            {
+                return false;
+            }
+        }
+
+        displacements[buckets[i].index] = displacement;
+    }
+
+    size_t free_slot = 0;
+    for(; (i < count) && (1 == buckets[i].size); i++)
+    {
+        while (JRPC_METHOD_TABLE_EMPTY_SLOT != slots[free_slot])
+        {
+            free_slot++;
+        }
+
+        slots[free_slot] = (int32_t) order[buckets[i].start];
+        displacements[buckets[i].index] = -((int32_t) free_slot) - 1;
+    }
+
+    return true;
+}
+
+void jrpc_method_table_init(
+    struct jrpc_method_table * table)
+{
+    table->entries = NULL;
+    table->count = 0;
+    table->capacity = 0;
+    table->slots = NULL;
+    table->slot_count = 0;
+    table->displacements = NULL;
+    table->is_frozen = false;
+}
+
+void jrpc_method_table_cleanup(
+    struct jrpc_method_table * table)
+{
+    for(size_t i = 0; i < table->count; i++)
+    {
+        free(table->entries[i].name);
+    }
+
+    free(table->entries);
+    jrpc_method_table_reset_slots(table);
+    jrpc_method_table_init(table);
+}
+
+void jrpc_method_table_add(
+    struct jrpc_method_table * table,
+    char const * name,
+    enum jrpc_method_kind kind,
+    union jrpc_method_handler handler,
+    void * user_data)
+{
+    struct jrpc_method_entry * entry = (struct jrpc_method_entry *) jrpc_method_table_lookup(table, name);
+    if (NULL == entry)
+    {
+        if (table->count == table->capacity)
+        {
+            size_t const capacity = (0 < table->capacity) ? (2 * table->capacity) : JRPC_METHOD_TABLE_INITIAL_CAPACITY;
+            struct jrpc_method_entry * entries = realloc(table->entries, capacity * sizeof(struct jrpc_method_entry));
+            if (NULL == entries)
+            {
+                return;
+            }
+
+            table->entries = entries;
+            table->capacity = capacity;
+        }
+
+        char * interned_name = strdup(name);
+        if (NULL == interned_name)
+        {
+            return;
+        }
+
+        entry = &table->entries[table->count];
+        entry->name = interned_name;
+        entry->hash = jrpc_method_table_hash(name);
+        table->count++;
+
+        if ((table->is_frozen) || (table->slot_count < (2 * table->count)))
+        {
+            if (!jrpc_method_table_rehash(table))
+            {
+                table->count--;
+                free(interned_name);
+                return;
+            }
+        }
+        else
+        {
+            size_t slot = entry->hash & (table->slot_count - 1);
+            while (JRPC_METHOD_TABLE_EMPTY_SLOT != table->slots[slot])
+            {
+                slot = (slot + 1) & (table->slot_count - 1);
+            }
+
+            table->slots[slot] = (int32_t) (table->count - 1);
+        }
+    }
+
+    entry->kind = kind;
+    entry->handler = handler;
+    entry->user_data = user_data;
+}
+
+void jrpc_method_table_freeze(
+    struct jrpc_method_table * table)
+{
+    size_t const count = table->count;
+    if ((table->is_frozen) || (0 == count))
+    {
+        return;
+    }
+
+    struct jrpc_method_bucket * buckets = malloc(count * sizeof(struct jrpc_method_bucket));
+    size_t * order = malloc(count * sizeof(size_t));
+    int32_t * slots = malloc(count * sizeof(int32_t));
+    int32_t * displacements = malloc(count * sizeof(int32_t));
+
+    if ((NULL != buckets) && (NULL != order) && (NULL != slots) && (NULL != displacements) &&
+        (jrpc_method_table_build_perfect(table, buckets, order, slots, displacements)))
+    {
+        jrpc_method_table_reset_slots(table);
+        table->slots = slots;
+        table->slot_count = count;
+        table->displacements = displacements;
+        table->is_frozen = true;
+    }
+    else
+    {
+        // keep open addressing
+        free(slots);
+        free(displacements);
+    }
+
+    free(buckets);
+    free(order);
+}
+
+struct jrpc_method_entry const * jrpc_method_table_lookup(
+    struct jrpc_method_table const * table,
+    char const * name)
+{
+    if (0 == table->count)
+    {
+        return NULL;
+    }
+
+    uint32_t const hash = jrpc_method_table_hash(name);
+
+    if (table->is_frozen)
+    {
+        int32_t const displacement = table->displacements[hash % table->slot_count];
+        size_t const slot = (0 > displacement)
+            ? (size_t) (-displacement - 1)
+            : jrpc_method_table_displace(hash, displacement) % table->slot_count;
+
+        int32_t const index = table->slots[slot];
+        if ((JRPC_METHOD_TABLE_EMPTY_SLOT != index) && (0 == strcmp(table->entries[index].name, name)))
+        {
+            return &table->entries[index];
+        }
+
+        return NULL;
+    }
+
+    size_t slot = hash & (table->slot_count - 1);
+    while (JRPC_METHOD_TABLE_EMPTY_SLOT != table->slots[slot])
+    {
+        struct jrpc_method_entry const * entry = &table->entries[table->slots[slot]];
+        if ((hash == entry->hash) && (0 == strcmp(entry->name, name)))
+        {
+            return entry;
+        }
+
+        slot = (slot + 1) & (table->slot_count - 1);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,106 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_METHOD_TABLE_H
+#define JRPC_METHOD_TABLE_H
+
+#include "jrpc/server.h"
+
+#ifndef __cplusplus
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#else
+#include <cstddef>
+#include <cstdint>
+using ::std::size_t;
+#endif
+
+enum jrpc_method_kind
+{
+    JRPC_METHOD_JSON,
+    JRPC_METHOD_RAW,
+    JRPC_METHOD_OFFLOADED
+};
+
+union jrpc_method_handler
+{
+    jrpc_method_fn * method;
+    jrpc_method_raw_fn * method_raw;
+    jrpc_notification_fn * notification;
+    jrpc_notification_raw_fn * notification_raw;
+    jrpc_offloaded_method_fn * offloaded;
+};
+
+struct jrpc_method_entry
+{
+    char * name;
+    uint32_t hash;
+    enum jrpc_method_kind kind;
+    union jrpc_method_handler handler;
+    void * user_data;
+};
+
+struct jrpc_method_table
+{
+    struct jrpc_method_entry * entries;
+    size_t count;
+    size_t capacity;
+    int32_t * slots;
+    size_t slot_count;
+    int32_t * displacements;
+    bool is_frozen;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern void jrpc_method_table_init(
+    struct jrpc_method_table * table);
+
+extern void jrpc_method_table_cleanup(
+    struct jrpc_method_table * table);
+
+extern void jrpc_method_table_add(
+    struct jrpc_method_table * table,
+    char const * name,
+    enum jrpc_method_kind kind,
+    union jrpc_method_handler handler,
+    void * user_data);
+
+extern void jrpc_method_table_freeze(
+    struct jrpc_method_table * table);
+
+extern struct jrpc_method_entry const * jrpc_method_table_lookup(
+    struct jrpc_method_table const * table,
+    char const * name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/mpsc_queue.h"
+
+#include <stddef.h>
+
+// Intrusive multi-producer single-consumer queue (D. Vyukov).
+// Producers only swap the head, so push is wait-free; pop may only
+// be called by the consumer (the service thread).
+
+void jrpc_mpsc_queue_init(
+    struct jrpc_mpsc_queue * queue)
+{
+    atomic_init(&queue->stub.next, NULL);
+    atomic_init(&queue->head, &queue->stub);
+    queue->tail = &queue->stub;
+}
+
+void jrpc_mpsc_queue_push(
+    struct jrpc_mpsc_queue * queue,
+    struct jrpc_mpsc_node * node)
+{
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    struct jrpc_mpsc_node * prev = atomic_exchange_explicit(&queue->head, node, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+struct jrpc_mpsc_node * jrpc_mpsc_queue_pop(
+    struct jrpc_mpsc_queue * queue)
+{
+    struct jrpc_mpsc_node * tail = queue->tail;
+    struct jrpc_mpsc_node * next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+    if (&queue->stub == tail)
+    {
+        if (NULL == next)
+        {
+            return NULL;
+        }
+
+        queue->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&next->next, memory_order_acquire);
+    }
+
+    if (NULL != next)
+    {
+        queue->tail = next;
+        return tail;
+    }
+
+    struct jrpc_mpsc_node * head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail != head)
+    {
+        // a producer is about to link its node; it will wake us up again
+        return NULL;
+    }
+
+    jrpc_mpsc_queue_push(queue, &queue->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (NULL != next)
+    {
+        queue->tail = next;
+        return tail;
+    }
+
+    return NULL;
+}
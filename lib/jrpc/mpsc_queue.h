@@ -0,0 +1,62 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_MPSC_QUEUE_H
+#define JRPC_MPSC_QUEUE_H
+
+#include <stdatomic.h>
+
+struct jrpc_mpsc_node
+{
+    struct jrpc_mpsc_node * _Atomic next;
+};
+
+struct jrpc_mpsc_queue
+{
+    struct jrpc_mpsc_node * _Atomic head;
+    struct jrpc_mpsc_node * tail;
+    struct jrpc_mpsc_node stub;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern void jrpc_mpsc_queue_init(
+    struct jrpc_mpsc_queue * queue);
+
+extern void jrpc_mpsc_queue_push(
+    struct jrpc_mpsc_queue * queue,
+    struct jrpc_mpsc_node * node);
+
+extern struct jrpc_mpsc_node * jrpc_mpsc_queue_pop(
+    struct jrpc_mpsc_queue * queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
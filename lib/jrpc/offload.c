@@ -0,0 +1,168 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/offload.h"
+#include "jrpc/protocol.h"
+#include "jrpc/connection_intern.h"
+#include "jrpc/worker_pool.h"
+#include "jrpc/loop.h"
+#include "jrpc/post.h"
+
+#include <stdlib.h>
+
+struct jrpc_offload
+{
+    struct jrpc_worker_job job;
+    struct jrpc_server * server;
+    jrpc_connection_handle handle;
+    jrpc_offloaded_method_fn * handler;
+    void * user_data;
+    json_t * params;
+    int id;
+};
+
+struct jrpc_offload_work
+{
+    struct jrpc_worker_job job;
+    struct jrpc_loop * loop;
+    jrpc_work_fn * work;
+    jrpc_work_done_fn * done;
+    void * user_data;
+};
+
+static void jrpc_offload_run(
+    struct jrpc_worker_job * job)
+{
+    struct jrpc_offload * offload = (struct jrpc_offload *) job;
+
+    int error_code = -1;
+    char const * error_message = "internal error";
+    json_t * result = offload->handler(offload->params, &error_code, &error_message, offload->user_data);
+
+    if (NULL != result)
+    {
+        jrpc_respond_threadsafe(offload->server, offload->handle, result, offload->id);
+    }
+    else
+    {
+        jrpc_respond_error_threadsafe(offload->server, offload->handle, error_code, error_message, offload->id);
+    }
+
+    json_decref(offload->params);
+    free(offload);
+}
+
+static void jrpc_offload_discard(
+    struct jrpc_worker_job * job)
+{
+    struct jrpc_offload * offload = (struct jrpc_offload *) job;
+
+    json_decref(offload->params);
+    free(offload);
+}
+
+bool jrpc_offload_submit(
+    struct jrpc_protocol * protocol,
+    struct jrpc_connection * connection,
+    struct jrpc_method_entry const * entry,
+    json_t * params,
+    int id)
+{
+    struct jrpc_offload * offload = malloc(sizeof(struct jrpc_offload));
+    if (NULL == offload)
+    {
+        return false;
+    }
+
+    offload->job.run = &jrpc_offload_run;
+    offload->job.discard = &jrpc_offload_discard;
+    offload->server = protocol->server;
+    offload->handle = connection->handle;
+    offload->handler = entry->handler.offloaded;
+    offload->user_data = entry->user_data;
+    offload->params = json_incref(params);
+    offload->id = id;
+
+    if (!jrpc_worker_pool_submit(&protocol->workers, &offload->job))
+    {
+        jrpc_offload_discard(&offload->job);
+        return false;
+    }
+
+    return true;
+}
+
+static void jrpc_offload_work_run(
+    struct jrpc_worker_job * job)
+{
+    struct jrpc_offload_work * offload = (struct jrpc_offload_work *) job;
+
+    offload->work(offload->user_data);
+
+    struct jrpc_post * post = jrpc_post_create(JRPC_POST_CALL, 0, NULL, NULL);
+    if (NULL != post)
+    {
+        post->done = offload->done;
+        post->user_data = offload->user_data;
+        jrpc_loop_post(offload->loop, post);
+    }
+
+    free(offload);
+}
+
+static void jrpc_offload_work_discard(
+    struct jrpc_worker_job * job)
+{
+    free(job);
+}
+
+bool jrpc_offload_work_submit(
+    struct jrpc_protocol * protocol,
+    struct jrpc_loop * loop,
+    jrpc_work_fn * work,
+    jrpc_work_done_fn * done,
+    void * user_data)
+{
+    struct jrpc_offload_work * offload = malloc(sizeof(struct jrpc_offload_work));
+    if (NULL == offload)
+    {
+        return false;
+    }
+
+    offload->job.run = &jrpc_offload_work_run;
+    offload->job.discard = &jrpc_offload_work_discard;
+    offload->loop = loop;
+    offload->work = work;
+    offload->done = done;
+    offload->user_data = user_data;
+
+    if (!jrpc_worker_pool_submit(&protocol->workers, &offload->job))
+    {
+        free(offload);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,64 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_OFFLOAD_H
+#define JRPC_OFFLOAD_H
+
+#include "jrpc/server.h"
+#include <jansson.h>
+
+#ifndef __cplusplus
+#include <stdbool.h>
+#endif
+
+struct jrpc_protocol;
+struct jrpc_loop;
+struct jrpc_connection;
+struct jrpc_method_entry;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern bool jrpc_offload_submit(
+    struct jrpc_protocol * protocol,
+    struct jrpc_connection * connection,
+    struct jrpc_method_entry const * entry,
+    json_t * params,
+    int id);
+
+extern bool jrpc_offload_work_submit(
+    struct jrpc_protocol * protocol,
+    struct jrpc_loop * loop,
+    jrpc_work_fn * work,
+    jrpc_work_done_fn * done,
+    void * user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/post.h"
+#include "jrpc/loop.h"
+#include "jrpc/protocol.h"
+#include "jrpc/connection_intern.h"
+#include "jrpc/message.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct jrpc_post * jrpc_post_create(
+    enum jrpc_post_type type,
+    uint64_t handle,
+    json_t * value,
+    char const * text)
+{
+    struct jrpc_post * post = malloc(sizeof(struct jrpc_post));
+    if (NULL == post)
+    {
+        json_decref(value);
+        return NULL;
+    }
+
+    post->type = type;
+    post->handle = handle;
+    post->value = value;
+    post->text = (NULL != text) ? strdup(text) : NULL;
+    post->length = 0;
+    post->topic = NULL;
+    post->error_code = 0;
+    post->id = 0;
+    post->done = NULL;
+    post->user_data = NULL;
+
+    return post;
+}
+
+struct jrpc_post * jrpc_post_create_copy(
+    enum jrpc_post_type type,
+    uint64_t handle,
+    char const * data,
+    size_t length)
+{
+    char * text = malloc(length);
+    if (NULL == text)
+    {
+        return NULL;
+    }
+
+    struct jrpc_post * post = jrpc_post_create(type, handle, NULL, NULL);
+    if (NULL == post)
+    {
+        free(text);
+        return NULL;
+    }
+
+    memcpy(text, data, length);
+    post->text = text;
+    post->length = length;
+
+    return post;
+}
+
+void jrpc_post_dispose(
+    struct jrpc_post * post)
+{
+    json_decref(post->value);
+    free(post->text);
+    free(post->topic);
+    free(post);
+}
+
+void jrpc_post_execute(
+    struct jrpc_post * post,
+    struct jrpc_loop * loop)
+{
+    if ((JRPC_POST_BROADCAST == post->type) || (JRPC_POST_PUBLISH == post->type))
+    {
+        struct jrpc_message * message = jrpc_message_create_copy(&loop->pool, post->text, post->length, JRPC_MESSAGE_NOTIFICATION);
+        if (NULL != message)
+        {
+            if (JRPC_POST_BROADCAST == post->type)
+            {
+                jrpc_loop_broadcast(loop, message);
+            }
+            else if (NULL != post->topic)
+            {
+                jrpc_loop_publish(loop, post->topic, message);
+            }
+
+            jrpc_message_dispose(message);
+        }
+
+        jrpc_post_dispose(post);
+        return;
+    }
+
+    if (JRPC_POST_CALL == post->type)
+    {
+        post->done(loop->protocol->server, post->user_data);
+        jrpc_post_dispose(post);
+        return;
+    }
+
+    struct jrpc_connection * connection = jrpc_registry_resolve(&loop->registry, post->handle);
+    if (NULL != connection)
+    {
+        switch (post->type)
+        {
+        case JRPC_POST_RESPONSE:
+            jrpc_respond(connection, post->value, post->id);
+            post->value = NULL;
+            break;
+        case JRPC_POST_ERROR:
+            jrpc_respond_error(connection, post->error_code, (NULL != post->text) ? post->text : "", post->id);
+            break;
+        case JRPC_POST_NOTIFICATION:
+            jrpc_notify(connection, (NULL != post->text) ? post->text : "", post->value);
+            post->value = NULL;
+            break;
+        case JRPC_POST_MESSAGE:
+            {
+                struct jrpc_message * message = jrpc_message_create_copy(&loop->pool, post->text, post->length, JRPC_MESSAGE_NOTIFICATION);
+                if (NULL != message)
+                {
+                    jrpc_connection_enqueue(connection, message);
+                    jrpc_message_dispose(message);
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    jrpc_post_dispose(post);
+}
@@ -0,0 +1,98 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_POST_H
+#define JRPC_POST_H
+
+#include "jrpc/mpsc_queue.h"
+#include "jrpc/server.h"
+#include <jansson.h>
+
+#ifndef __cplusplus
+#include <stddef.h>
+#include <stdint.h>
+#else
+#include <cstddef>
+#include <cstdint>
+using ::std::size_t;
+#endif
+
+struct jrpc_loop;
+
+enum jrpc_post_type
+{
+    JRPC_POST_RESPONSE,
+    JRPC_POST_ERROR,
+    JRPC_POST_NOTIFICATION,
+    JRPC_POST_MESSAGE,
+    JRPC_POST_BROADCAST,
+    JRPC_POST_PUBLISH,
+    JRPC_POST_CALL
+};
+
+struct jrpc_post
+{
+    struct jrpc_mpsc_node node;
+    enum jrpc_post_type type;
+    uint64_t handle;
+    json_t * value;
+    char * text;
+    size_t length;
+    char * topic;
+    int error_code;
+    int id;
+    jrpc_work_done_fn * done;
+    void * user_data;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern struct jrpc_post * jrpc_post_create(
+    enum jrpc_post_type type,
+    uint64_t handle,
+    json_t * value,
+    char const * text);
+
+extern struct jrpc_post * jrpc_post_create_copy(
+    enum jrpc_post_type type,
+    uint64_t handle,
+    char const * data,
+    size_t length);
+
+extern void jrpc_post_dispose(
+    struct jrpc_post * post);
+
+extern void jrpc_post_execute(
+    struct jrpc_post * post,
+    struct jrpc_loop * loop);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -24,47 +24,430 @@
  */
 
 #include "jrpc/protocol.h"
+#include "jrpc/loop.h"
 #include "jrpc/connection_intern.h"
 #include "jrpc/message.h"
+#include "jrpc/envelope.h"
+#include "jrpc/post.h"
+#include "jrpc/offload.h"
 #include "jrpc/util.h"
 
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <unistd.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 
-static void jrpc_protocol_process(
+#define JRPC_PROTOCOL_DEFAULT_WRITE_MAX_MESSAGES 32
+#define JRPC_PROTOCOL_DEFAULT_WRITE_MAX_BYTES (64 * 1024)
+#define JRPC_PROTOCOL_DEFAULT_FRAGMENT_SIZE (64 * 1024)
+#define JRPC_PROTOCOL_DEFAULT_MAX_MESSAGE_SIZE (16 * 1024 * 1024)
+#define JRPC_PROTOCOL_RECEIVE_BUFFER_IDLE_TIMEOUT_US (5 * 1000 * 1000)
+#define JRPC_PROTOCOL_DEFAULT_WORKER_THREADS 4
+#define JRPC_PROTOCOL_DEFAULT_PRIORITY_WEIGHT 8
+#define JRPC_PROTOCOL_CANCEL_METHOD "$/cancelRequest"
+
+static void jrpc_default_onmethod(
+    struct jrpc_connection * connection,
+    char const * method_name,
+    json_t * params,
+    int id);
+
+static void jrpc_default_onnotify(
+    struct jrpc_connection * connection,
+    char const * method_name,
+    json_t * content);
+
+static void jrpc_protocol_dispatch_registered(
+    struct jrpc_protocol * protocol,
+    struct jrpc_connection * connection,
+    struct jrpc_method_entry const * entry,
+    struct jrpc_envelope const * envelope)
+{
+    if ((JRPC_METHOD_RAW == entry->kind) && (envelope->has_id))
+    {
+        entry->handler.method_raw(connection, envelope->params, envelope->params_length, envelope->id, entry->user_data);
+    }
+    else if (JRPC_METHOD_RAW == entry->kind)
+    {
+        entry->handler.notification_raw(connection, envelope->params, envelope->params_length, entry->user_data);
+    }
+    else
+    {
+        json_t * params = json_loadb(envelope->params, envelope->params_length, 0, NULL);
+        if (NULL != params)
+        {
+            if (JRPC_METHOD_OFFLOADED == entry->kind)
+            {
+                if (!jrpc_offload_submit(protocol, connection, entry, params, envelope->id))
+                {
+                    jrpc_respond_error(connection, -1, "not available", envelope->id);
+                }
+            }
+            else if (envelope->has_id)
+            {
+                entry->handler.method(connection, params, envelope->id, entry->user_data);
+            }
+            else
+            {
+                entry->handler.notification(connection, params, entry->user_data);
+            }
+
+            json_decref(params);
+        }
+    }
+}
+
+static void jrpc_protocol_cancel_request(
+    struct jrpc_connection * connection,
+    struct jrpc_envelope const * envelope)
+{
+    json_t * params = json_loadb(envelope->params, envelope->params_length, 0, NULL);
+    if (NULL != params)
+    {
+        json_t * id = json_is_array(params) ? json_array_get(params, 0) : json_object_get(params, "id");
+        if (json_is_integer(id))
+        {
+            jrpc_connection_cancel_request(connection, json_integer_value(id));
+        }
+
+        json_decref(params);
+    }
+}
+
+static void jrpc_protocol_dispatch(
+    struct jrpc_protocol * protocol,
+    struct jrpc_connection * connection,
+    struct jrpc_envelope const * envelope)
+{
+    if ((!envelope->has_id) && (protocol->is_cancellation_enabled)
+        && (0 == strcmp(JRPC_PROTOCOL_CANCEL_METHOD, envelope->method)))
+    {
+        jrpc_protocol_cancel_request(connection, envelope);
+        return;
+    }
+
+    struct jrpc_method_entry const * entry = jrpc_method_table_lookup(
+        (envelope->has_id) ? &protocol->methods : &protocol->notifications, envelope->method);
+
+    if ((envelope->has_id) && (protocol->is_tracking_requests))
+    {
+        // responses to requests sharing an id could not be told apart
+        if (NULL != jrpc_inflight_find(&connection->inflight, envelope->id))
+        {
+            jrpc_connection_reject_duplicate(connection, envelope->id);
+            return;
+        }
+
+        jrpc_connection_track_request(connection, envelope->id);
+    }
+
+    if (NULL != entry)
+    {
+        jrpc_protocol_dispatch_registered(protocol, connection, entry, envelope);
+    }
+    else if ((envelope->has_id) && (NULL != protocol->onmethod_raw))
+    {
+        protocol->onmethod_raw(connection, envelope->method, envelope->params, envelope->params_length, envelope->id);
+    }
+    else if ((!envelope->has_id) && (NULL != protocol->onnotify_raw))
+    {
+        protocol->onnotify_raw(connection, envelope->method, envelope->params, envelope->params_length);
+    }
+    else if ((envelope->has_id) && (&jrpc_default_onmethod == protocol->onmethod))
+    {
+        jrpc_default_onmethod(connection, envelope->method, NULL, envelope->id);
+    }
+    else if ((envelope->has_id) || (&jrpc_default_onnotify != protocol->onnotify))
+    {
+        json_t * params = json_loadb(envelope->params, envelope->params_length, 0, NULL);
+        if (NULL != params)
+        {
+            if (envelope->has_id)
+            {
+                protocol->onmethod(connection, envelope->method, params, envelope->id);
+            }
+            else
+            {
+                protocol->onnotify(connection, envelope->method, params);
+            }
+
+            json_decref(params);
+        }
+    }
+}
+
+static void jrpc_protocol_process_batch(
     struct jrpc_protocol * protocol,
     struct jrpc_connection * connection,
     char const * buffer,
     size_t length
 )
 {
-    json_t * request = json_loadb(buffer, length, 0, NULL);
-    if (NULL != request)
+    struct jrpc_envelope * envelopes;
+    size_t count;
+    if ((!jrpc_envelope_parse_batch(buffer, length, &envelopes, &count)) || (0 == count))
     {
-        json_t * name_holder = json_object_get(request, "method");
-        json_t * params = json_object_get(request, "params");
-        json_t * id_holder = json_object_get(request, "id");
+        return;
+    }
 
-        if ((NULL != name_holder) && (json_is_string(name_holder)) &&
-            (NULL != params) && (json_is_array(params) || json_is_object(params)))
+    struct jrpc_batch * batch = NULL;
+    int * ids = malloc(count * sizeof(int));
+    if (NULL != ids)
+    {
+        size_t id_count = 0;
+        for(size_t i = 0; i < count; i++)
         {
-            char const * method_name = json_string_value(name_holder);
-
-            if ((NULL != id_holder) && (json_is_integer(id_holder)))
+            if ((NULL != envelopes[i].method) && (envelopes[i].has_id))
             {
-                int id = json_integer_value(id_holder);
-                protocol->onmethod(connection, method_name, params, id);
+                ids[id_count++] = envelopes[i].id;
             }
-            else
+        }
+
+        batch = jrpc_connection_begin_batch(connection, ids, id_count);
+        free(ids);
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        if (NULL != envelopes[i].method)
+        {
+            jrpc_protocol_dispatch(protocol, connection, &envelopes[i]);
+        }
+        else if (envelopes[i].has_invalid_id)
+        {
+            jrpc_connection_reject_request(connection, batch);
+        }
+    }
+
+    jrpc_connection_end_batch(connection, batch);
+    jrpc_envelope_cleanup_batch(envelopes, count);
+}
+
+static void jrpc_protocol_process(
+    struct jrpc_protocol * protocol,
+    struct jrpc_connection * connection,
+    char const * buffer,
+    size_t length
+)
+{
+    if (jrpc_envelope_is_batch(buffer, length))
+    {
+        jrpc_protocol_process_batch(protocol, connection, buffer, length);
+        return;
+    }
+
+    struct jrpc_envelope envelope;
+    if (jrpc_envelope_parse(&envelope, buffer, length))
+    {
+        jrpc_protocol_dispatch(protocol, connection, &envelope);
+        jrpc_envelope_cleanup(&envelope);
+    }
+    else if (envelope.has_invalid_id)
+    {
+        jrpc_connection_reject_request(connection, NULL);
+    }
+}
+
+static int jrpc_protocol_receive(
+    struct jrpc_protocol * protocol,
+    struct jrpc_connection * connection,
+    struct lws * wsi,
+    char const * data,
+    size_t length)
+{
+    struct jrpc_buffer * buffer = &connection->receive_buffer;
+    bool const is_final = (0 != lws_is_final_fragment(wsi));
+    size_t const remaining = lws_remaining_packet_payload(wsi);
+
+    if ((0 < protocol->max_message_size) &&
+        (buffer->length + length + remaining > protocol->max_message_size))
+    {
+        unsigned char reason[] = "message too large";
+        jrpc_buffer_clear(buffer);
+        lws_close_reason(wsi, LWS_CLOSE_STATUS_MESSAGE_TOO_LARGE, reason, sizeof(reason) - 1);
+        return -1;
+    }
+
+    if ((is_final) && (0 == buffer->length))
+    {
+        jrpc_protocol_process(protocol, connection, data, length);
+    }
+    else
+    {
+        if (!jrpc_buffer_append(buffer, data, length))
+        {
+            return -1;
+        }
+
+        if (is_final)
+        {
+            jrpc_protocol_process(protocol, connection, buffer->data, buffer->length);
+            jrpc_buffer_clear(buffer);
+            lws_set_timer_usecs(wsi, JRPC_PROTOCOL_RECEIVE_BUFFER_IDLE_TIMEOUT_US);
+        }
+    }
+
+    return 0;
+}
+
+static int jrpc_protocol_write_fragment(
+    struct jrpc_protocol * protocol,
+    struct jrpc_connection * connection,
+    struct lws * wsi,
+    size_t * length)
+{
+    struct jrpc_loop * loop = connection->loop;
+    struct jrpc_message * message = connection->fragmented;
+    size_t const offset = connection->fragment_offset;
+    size_t const remaining = message->length - offset;
+    bool const is_final = (remaining <= protocol->fragment_size);
+
+    // messages may be shared by several connections, so lws must not write
+    // its frame header in front of a fragment within the message
+    if (NULL == loop->fragment_buffer)
+    {
+        loop->fragment_buffer = malloc(LWS_PRE + protocol->fragment_size);
+        if (NULL == loop->fragment_buffer)
+        {
+            return -1;
+        }
+    }
+
+    *length = (is_final) ? remaining : protocol->fragment_size;
+    memcpy(&loop->fragment_buffer[LWS_PRE], &message->data[offset], *length);
+
+    int const flags = ((0 == offset) ? LWS_WRITE_TEXT : LWS_WRITE_CONTINUATION) | ((is_final) ? 0 : LWS_WRITE_NO_FIN);
+    int const result = lws_write(wsi, &loop->fragment_buffer[LWS_PRE], *length, flags);
+
+    loop->write_stats.fragments_sent++;
+    connection->fragment_offset += *length;
+    if (is_final)
+    {
+        connection->fragmented = NULL;
+        connection->fragment_offset = 0;
+        jrpc_message_dispose(message);
+    }
+
+    return (0 > result) ? -1 : 0;
+}
+
+static int jrpc_protocol_write(
+    struct jrpc_protocol * protocol,
+    struct jrpc_connection * connection,
+    struct lws * wsi)
+{
+    struct jrpc_write_stats * stats = &connection->loop->write_stats;
+    int result = 0;
+    size_t messages_sent = 0;
+    size_t bytes_sent = 0;
+
+    // held back notifications are sent now
+    jrpc_loop_cancel_timer(connection->loop, &connection->flush_timer);
+
+    while ((0 == result) &&
+        (jrpc_connection_has_messages(connection)) &&
+        (messages_sent < protocol->write_max_messages) &&
+        (bytes_sent < protocol->write_max_bytes) &&
+        (!lws_send_pipe_choked(wsi)))
+    {
+        if (NULL == connection->fragmented)
+        {
+            struct jrpc_message * message = (connection->is_batching) ?
+                jrpc_connection_dequeue_batch(connection) : jrpc_connection_dequeue(connection);
+            if ((0 == protocol->fragment_size) || (message->length <= protocol->fragment_size))
             {
-                protocol->onnotify(connection, method_name, params);
+                if (0 > lws_write(wsi, (unsigned char *) message->data, message->length, LWS_WRITE_TEXT))
+                {
+                    result = -1;
+                }
+
+                messages_sent++;
+                bytes_sent += message->length;
+                jrpc_message_dispose(message);
+                continue;
             }
-            
+
+            // large messages are sent in fragments, spread over several callbacks
+            connection->fragmented = message;
+            connection->fragment_offset = 0;
+        }
+
+        size_t length = 0;
+        result = jrpc_protocol_write_fragment(protocol, connection, wsi, &length);
+        bytes_sent += length;
+        if (NULL == connection->fragmented)
+        {
+            messages_sent++;
         }
+    }
 
-        json_decref(request);
+    stats->writeable_callbacks++;
+    stats->messages_sent += messages_sent;
+    stats->bytes_sent += bytes_sent;
+    if (messages_sent > stats->max_messages_per_callback)
+    {
+        stats->max_messages_per_callback = messages_sent;
     }
+
+    return result;
+}
+
+static bool jrpc_protocol_is_poll_reason(
+    enum lws_callback_reasons reason)
+{
+    return ((LWS_CALLBACK_ADD_POLL_FD == reason) ||
+        (LWS_CALLBACK_DEL_POLL_FD == reason) ||
+        (LWS_CALLBACK_CHANGE_MODE_POLL_FD == reason));
+}
+
+static int jrpc_protocol_poll(
+    struct lws * wsi,
+    enum lws_callback_reasons reason,
+    void * in)
+{
+    // poll callbacks are delivered to the vhost's first protocol, so the
+    // loop is taken from the context instead of the protocol
+    struct jrpc_loop * loop = lws_context_user(lws_get_context(wsi));
+    struct lws_pollargs const * args = in;
+
+    if ((NULL == loop) || (0 != loop->index) || (NULL == loop->protocol->onpoll) || (NULL == args))
+    {
+        return 0;
+    }
+
+    enum jrpc_poll_action action;
+    switch (reason)
+    {
+    case LWS_CALLBACK_ADD_POLL_FD:
+        action = JRPC_POLL_ADD;
+        break;
+    case LWS_CALLBACK_DEL_POLL_FD:
+        action = JRPC_POLL_REMOVE;
+        break;
+    case LWS_CALLBACK_CHANGE_MODE_POLL_FD:
+        // fall-through
+    default:
+        action = JRPC_POLL_MODIFY;
+        break;
+    }
+
+    loop->protocol->onpoll(args->fd, action, args->events, loop->protocol->poll_user_data);
+    return 0;
+}
+
+static int jrpc_protocol_http_callback(
+    struct lws * wsi,
+    enum lws_callback_reasons reason,
+    void * user,
+    void * in,
+    size_t length
+)
+{
+    if (jrpc_protocol_is_poll_reason(reason))
+    {
+        return jrpc_protocol_poll(wsi, reason, in);
+    }
+
+    return lws_callback_http_dummy(wsi, reason, user, in, length);
 }
 
 static int jrpc_protocol_callback(
@@ -75,34 +458,47 @@ static int jrpc_protocol_callback(
     size_t length
 )
 {
+    if (jrpc_protocol_is_poll_reason(reason))
+    {
+        return jrpc_protocol_poll(wsi, reason, in);
+    }
+
     struct lws_protocols const * lws_protocol = lws_get_protocol(wsi);
     if (NULL == lws_protocol)
     {
         return 0;
     }
 
-    struct jrpc_protocol * protocol = lws_protocol->user;
+    struct jrpc_loop * loop = lws_protocol->user;
+    struct jrpc_protocol * protocol = loop->protocol;
     struct jrpc_connection * connection = user;
 
     switch (reason)
     {
     case LWS_CALLBACK_PROTOCOL_INIT:
+        // the batching variant of the protocol shares the loop's wakeup descriptor
+        if (NULL == loop->wakeup_wsi)
         {
             lws_sock_file_fd_type fd;
-            fd.sockfd = protocol->fd[0];
-            lws_adopt_descriptor_vhost(lws_get_vhost(wsi), LWS_ADOPT_RAW_FILE_DESC, fd, lws_protocol->name, NULL);
+            fd.filefd = loop->wakeup_fd;
+            loop->wakeup_wsi = lws_adopt_descriptor_vhost(lws_get_vhost(wsi), LWS_ADOPT_RAW_FILE_DESC, fd, lws_protocol->name, NULL);
+
+            // arm timers added before the loop was started
+            jrpc_loop_process_timers(loop);
         }
         break;
     case LWS_CALLBACK_ESTABLISHED:
         if (NULL != connection)
         {
-            jrpc_connection_init(connection, protocol->server, wsi);
+            jrpc_connection_init(connection, loop, wsi);
+            connection->is_batching = (JRPC_PROTOCOL_ID_BATCH == lws_protocol->id);
             protocol->onconnected(connection);
         }
         break;
     case LWS_CALLBACK_CLOSED:
         if (NULL != connection)
         {
+            jrpc_connection_cancel_all(connection);
             protocol->ondisconnected(connection);
             jrpc_connection_cleanup(connection);
         }
@@ -110,28 +506,46 @@ static int jrpc_protocol_callback(
     case LWS_CALLBACK_RECEIVE:
         if (NULL != connection)
         {
-            jrpc_protocol_process(protocol, connection, in, length);
+            if (0 != jrpc_protocol_receive(protocol, connection, wsi, in, length))
+            {
+                return -1;
+            }
+        }
+        break;
+    case LWS_CALLBACK_TIMER:
+        if (wsi == loop->wakeup_wsi)
+        {
+            jrpc_loop_process_timers(loop);
+            return 0;
+        }
+        else if ((NULL != connection) && (0 == connection->receive_buffer.length))
+        {
+            jrpc_buffer_cleanup(&connection->receive_buffer);
         }
         break;
     case LWS_CALLBACK_SERVER_WRITEABLE:
-        if ((NULL != connection) && (!jrpc_queue_is_empty(&connection->messages)))
+        if ((NULL != connection) && (jrpc_connection_has_messages(connection)))
         {
-            struct jrpc_message * message = jrpc_queue_dequeue(&connection->messages);
-            lws_write(wsi, (unsigned char *) message->data, message->length, LWS_WRITE_TEXT);
-            jrpc_message_dispose(message);
+            if (0 != jrpc_protocol_write(protocol, connection, wsi))
+            {
+                return -1;
+            }
         }
         break;
     case LWS_CALLBACK_RAW_RX_FILE:
+        jrpc_loop_process_posts(loop);
+        break;
+    case LWS_CALLBACK_RAW_CLOSE_FILE:
+        if (wsi == loop->wakeup_wsi)
         {
-            char temp;
-            read(protocol->fd[0], &temp, 1); /* Flawfinder: ignore */
+            loop->wakeup_wsi = NULL;
         }
-        break;
+        return 0;
     default:
         break;
     }
 
-    if ((NULL != connection) && (!jrpc_queue_is_empty(&connection->messages)))
+    if ((NULL != connection) && (jrpc_connection_needs_write(connection)))
     {
         lws_callback_on_writable(wsi);
     }
@@ -168,6 +582,19 @@ static void jrpc_default_ondisconnected(
     // empty
 }
 
+static void jrpc_default_onwatermark(
+    struct jrpc_connection * JRPC_UNUSED_PARAM(connection))
+{
+    // empty
+}
+
+static void jrpc_default_oncancel(
+    struct jrpc_connection * JRPC_UNUSED_PARAM(connection),
+    int JRPC_UNUSED_PARAM(id))
+{
+    // empty
+}
+
 
 void jrpc_server_protocol_init(
     struct jrpc_protocol * protocol,
@@ -176,32 +603,140 @@ void jrpc_server_protocol_init(
     protocol->server = server;
     protocol->onmethod = &jrpc_default_onmethod;
     protocol->onnotify = &jrpc_default_onnotify;
+    protocol->onmethod_raw = NULL;
+    protocol->onnotify_raw = NULL;
+    jrpc_method_table_init(&protocol->methods);
+    jrpc_method_table_init(&protocol->notifications);
+    jrpc_worker_pool_init(&protocol->workers, JRPC_PROTOCOL_DEFAULT_WORKER_THREADS);
+    protocol->uses_workers = false;
     protocol->onconnected = &jrpc_default_onconnected;
     protocol->ondisconnected = &jrpc_default_ondisconnected;
+    protocol->onhighwatermark = &jrpc_default_onwatermark;
+    protocol->onlowwatermark = &jrpc_default_onwatermark;
+    protocol->loops = NULL;
+    protocol->loop_count = 0;
+    protocol->use_cpu_affinity = false;
+    protocol->onpoll = NULL;
+    protocol->poll_user_data = NULL;
+    protocol->write_max_messages = JRPC_PROTOCOL_DEFAULT_WRITE_MAX_MESSAGES;
+    protocol->write_max_bytes = JRPC_PROTOCOL_DEFAULT_WRITE_MAX_BYTES;
+    protocol->fragment_size = JRPC_PROTOCOL_DEFAULT_FRAGMENT_SIZE;
+    protocol->max_message_size = JRPC_PROTOCOL_DEFAULT_MAX_MESSAGE_SIZE;
+    protocol->request_timeout_ms = 0;
+    protocol->batch_window_ms = 0;
+    protocol->batch_max_bytes = 0;
+    protocol->is_cancellation_enabled = false;
+    protocol->is_tracking_requests = false;
+    protocol->oncancel = &jrpc_default_oncancel;
+    protocol->outbound_max_bytes = 0;
+    protocol->outbound_max_messages = 0;
+    protocol->overflow_policy = JRPC_OVERFLOW_DROP_OLDEST;
+    protocol->low_watermark = 0;
+    protocol->high_watermark = 0;
+    protocol->priority_weight = JRPC_PROTOCOL_DEFAULT_PRIORITY_WEIGHT;
 
-    socketpair(AF_UNIX, SOCK_DGRAM, 0, protocol->fd);
+    jrpc_protocol_set_loops(protocol, 1);
 }
 
 void jrpc_protocol_cleanup(
-    struct jrpc_protocol * JRPC_UNUSED_PARAM(protocol))
+    struct jrpc_protocol * protocol)
 {
-    close(protocol->fd[0]);
-    close(protocol->fd[1]);
+    // stop additional loops first, so that no callback runs concurrently
+    for(size_t i = 0; i < protocol->loop_count; i++)
+    {
+        jrpc_loop_stop(&protocol->loops[i]);
+    }
+
+    jrpc_worker_pool_cleanup(&protocol->workers);
+    jrpc_protocol_set_loops(protocol, 0);
+    jrpc_method_table_cleanup(&protocol->methods);
+    jrpc_method_table_cleanup(&protocol->notifications);
 }
 
-void jrpc_protocol_init_lws(
+bool jrpc_protocol_set_loops(
     struct jrpc_protocol * protocol,
+    size_t loop_count)
+{
+    struct jrpc_loop * loops = NULL;
+    if (0 < loop_count)
+    {
+        loops = malloc(loop_count * sizeof(struct jrpc_loop));
+        if (NULL == loops)
+        {
+            return false;
+        }
+    }
+
+    for(size_t i = 0; i < loop_count; i++)
+    {
+        jrpc_loop_init(&loops[i], protocol, i);
+        if (0 < protocol->loop_count)
+        {
+            jrpc_message_pool_set_limits(&loops[i].pool,
+                protocol->loops[0].pool.max_messages_per_class, protocol->loops[0].pool.max_bytes);
+        }
+    }
+
+    for(size_t i = 0; i < protocol->loop_count; i++)
+    {
+        jrpc_loop_cleanup(&protocol->loops[i]);
+    }
+    free(protocol->loops);
+
+    protocol->loops = loops;
+    protocol->loop_count = loop_count;
+
+    return true;
+}
+
+void jrpc_protocol_init_lws_http(
+    struct jrpc_loop * loop,
+    struct lws_protocols * lws_protocol
+)
+{
+    lws_protocol->name = "http";
+    lws_protocol->callback = &jrpc_protocol_http_callback;
+    lws_protocol->user = loop;
+}
+
+void jrpc_protocol_init_lws(
+    struct jrpc_loop * loop,
     struct lws_protocols * lws_protocol
 )
 {
     lws_protocol->callback = &jrpc_protocol_callback;
     lws_protocol->per_session_data_size = sizeof(struct jrpc_connection);
-    lws_protocol->user = protocol;
+    lws_protocol->user = loop;
 }
 
-extern void jrpc_protocol_wakeup(
+struct jrpc_loop * jrpc_protocol_get_current_loop(
     struct jrpc_protocol * protocol)
 {
-    char value = 42;
-    write(protocol->fd[1], &value, 1);
+    // loops are owned by their thread: other threads must post to them
+    struct jrpc_loop * loop = jrpc_loop_current();
+    return ((NULL != loop) && (protocol == loop->protocol)) ? loop : NULL;
+}
+
+struct jrpc_loop * jrpc_protocol_get_loop(
+    struct jrpc_protocol * protocol,
+    uint64_t handle)
+{
+    uint32_t const index = jrpc_registry_get_tag(handle);
+
+    return (index < protocol->loop_count) ? &protocol->loops[index] : NULL;
+}
+
+void jrpc_protocol_post(
+    struct jrpc_protocol * protocol,
+    struct jrpc_post * post)
+{
+    struct jrpc_loop * loop = jrpc_protocol_get_loop(protocol, post->handle);
+    if (NULL != loop)
+    {
+        jrpc_loop_post(loop, post);
+    }
+    else
+    {
+        jrpc_post_dispose(post);
+    }
 }
@@ -27,19 +27,54 @@
 #define JRPC_PROTOCOL_H
 
 #include "jrpc/server.h"
+#include "jrpc/method_table.h"
+#include "jrpc/worker_pool.h"
 #include <libwebsockets.h>
 
+#define JRPC_PROTOCOL_ID_DEFAULT 0
+#define JRPC_PROTOCOL_ID_BATCH 1
+
 struct jrpc_server;
+struct jrpc_post;
+struct jrpc_loop;
 
 struct jrpc_protocol
 {
     struct jrpc_server * server;
     jrpc_invoke_fn * onmethod;
     jrpc_notify_fn * onnotify;
+    jrpc_invoke_raw_fn * onmethod_raw;
+    jrpc_notify_raw_fn * onnotify_raw;
+    struct jrpc_method_table methods;
+    struct jrpc_method_table notifications;
+    struct jrpc_worker_pool workers;
+    bool uses_workers;
     jrpc_connected_fn * onconnected;
     jrpc_disconnected_fn * ondisconnected;
+    jrpc_watermark_fn * onhighwatermark;
+    jrpc_watermark_fn * onlowwatermark;
     void * user_data;
-    int fd[2];
+    struct jrpc_loop * loops;
+    size_t loop_count;
+    bool use_cpu_affinity;
+    jrpc_poll_fn * onpoll;
+    void * poll_user_data;
+    size_t write_max_messages;
+    size_t write_max_bytes;
+    size_t fragment_size;
+    size_t max_message_size;
+    unsigned int request_timeout_ms;
+    unsigned int batch_window_ms;
+    size_t batch_max_bytes;
+    bool is_cancellation_enabled;
+    bool is_tracking_requests;
+    jrpc_cancel_fn * oncancel;
+    size_t outbound_max_bytes;
+    size_t outbound_max_messages;
+    enum jrpc_overflow_policy overflow_policy;
+    size_t low_watermark;
+    size_t high_watermark;
+    size_t priority_weight;
 };
 
 #ifdef __cplusplus
@@ -54,14 +89,31 @@ extern void jrpc_server_protocol_init(
 extern void jrpc_protocol_cleanup(
     struct jrpc_protocol * protocol);
 
-extern void jrpc_protocol_init_lws(
+extern bool jrpc_protocol_set_loops(
     struct jrpc_protocol * protocol,
+    size_t loop_count);
+
+extern void jrpc_protocol_init_lws_http(
+    struct jrpc_loop * loop,
     struct lws_protocols * lws_protocol
 );
 
-extern void jrpc_protocol_wakeup(
+extern void jrpc_protocol_init_lws(
+    struct jrpc_loop * loop,
+    struct lws_protocols * lws_protocol
+);
+
+extern struct jrpc_loop * jrpc_protocol_get_current_loop(
     struct jrpc_protocol * protocol);
 
+extern struct jrpc_loop * jrpc_protocol_get_loop(
+    struct jrpc_protocol * protocol,
+    uint64_t handle);
+
+extern void jrpc_protocol_post(
+    struct jrpc_protocol * protocol,
+    struct jrpc_post * post);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,66 +26,163 @@
 #include "jrpc/queue.h"
 #include "jrpc/message.h"
 
-#include <stddef.h>
+#include <stdlib.h>
+
+#define JRPC_QUEUE_INITIAL_CAPACITY 8
+
+// Each message has a position, that is counted from the first message
+// ever appended. Positions of queued notifications are stable: removing
+// the oldest notification only shifts the responses queued before it.
+
+static bool jrpc_queue_grow(
+    struct jrpc_queue * queue)
+{
+    size_t const capacity = (0 < queue->capacity) ? (2 * queue->capacity) : JRPC_QUEUE_INITIAL_CAPACITY;
+    struct jrpc_message * * messages = malloc(capacity * sizeof(struct jrpc_message *));
+    if (NULL == messages)
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < queue->count; i++)
+    {
+        messages[i] = queue->messages[(queue->first + i) & (queue->capacity - 1)];
+    }
+
+    free(queue->messages);
+    queue->messages = messages;
+    queue->capacity = capacity;
+    queue->first = 0;
+
+    return true;
+}
 
 void jrpc_queue_init(
     struct jrpc_queue * queue)
 {
-    queue->first = NULL;
-    queue->last = NULL;
+    queue->messages = NULL;
+    queue->capacity = 0;
+    queue->first = 0;
+    queue->count = 0;
+    queue->bytes = 0;
+    queue->head = 0;
 }
 
 void jrpc_queue_cleanup(
     struct jrpc_queue * queue)
 {
-    struct jrpc_message * message = queue->first;
+    struct jrpc_message * message = jrpc_queue_dequeue(queue);
     while (NULL != message)
     {
-        struct jrpc_message * next = message->next;
         jrpc_message_dispose(message);
-        message = next;
+        message = jrpc_queue_dequeue(queue);
     }
 
+    free(queue->messages);
+    uint64_t const head = queue->head;
     jrpc_queue_init(queue);
+    queue->head = head;
 }
 
 bool jrpc_queue_is_empty(
     struct jrpc_queue * queue)
 {
-    return (NULL == queue->first);
+    return (0 == queue->count);
 }
 
-void jrpc_queue_append(
+bool jrpc_queue_append(
     struct jrpc_queue * queue,
     struct jrpc_message * message)
 {
-    message->next = NULL;
-
-    if (NULL != queue->last)
-    {
-        queue->last->next = message;
-        queue->last = message;
-    }
-    else
+    if ((queue->count == queue->capacity) && (!jrpc_queue_grow(queue)))
     {
-        queue->first = message;
-        queue->last = message;
+        return false;
     }
+
+    queue->messages[(queue->first + queue->count) & (queue->capacity - 1)] = message;
+    queue->count++;
+    queue->bytes += message->length;
+
+    return true;
 }
 
 struct jrpc_message * jrpc_queue_dequeue(
     struct jrpc_queue * queue)
 {
-    struct jrpc_message * const result = queue->first;
-    if (NULL != result)
+    struct jrpc_message * result = NULL;
+    if (0 < queue->count)
     {
-        queue->first = queue->first->next;
+        result = queue->messages[queue->first];
+        queue->first = (queue->first + 1) & (queue->capacity - 1);
+        queue->count--;
+        queue->bytes -= result->length;
+        queue->head++;
+    }
+
+    return result;
+}
 
-        if (NULL == queue->first)
+struct jrpc_message * jrpc_queue_remove_oldest(
+    struct jrpc_queue * queue,
+    enum jrpc_message_type type)
+{
+    size_t const mask = queue->capacity - 1;
+
+    for(size_t i = 0; i < queue->count; i++)
+    {
+        struct jrpc_message * const result = queue->messages[(queue->first + i) & mask];
+        if (type == result->type)
         {
-            queue->last = NULL;
+            for(size_t j = i; j > 0; j--)
+            {
+                queue->messages[(queue->first + j) & mask] = queue->messages[(queue->first + j - 1) & mask];
+            }
+
+            queue->first = (queue->first + 1) & mask;
+            queue->count--;
+            queue->bytes -= result->length;
+            queue->head++;
+
+            return result;
         }
     }
 
+    return NULL;
+}
+
+uint64_t jrpc_queue_get_tail(
+    struct jrpc_queue const * queue)
+{
+    return queue->head + queue->count;
+}
+
+struct jrpc_message * jrpc_queue_get(
+    struct jrpc_queue const * queue,
+    uint64_t position)
+{
+    if ((position < queue->head) || (position >= jrpc_queue_get_tail(queue)))
+    {
+        return NULL;
+    }
+
+    return queue->messages[(queue->first + (size_t) (position - queue->head)) & (queue->capacity - 1)];
+}
+
+struct jrpc_message * jrpc_queue_replace(
+    struct jrpc_queue * queue,
+    uint64_t position,
+    struct jrpc_message * message)
+{
+    if ((position < queue->head) || (position >= jrpc_queue_get_tail(queue)))
+    {
+        return NULL;
+    }
+
+    struct jrpc_message * * slot = &queue->messages[(queue->first + (size_t) (position - queue->head)) & (queue->capacity - 1)];
+    struct jrpc_message * const result = *slot;
+
+    *slot = message;
+    queue->bytes = queue->bytes - result->length + message->length;
+
     return result;
 }
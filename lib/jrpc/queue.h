@@ -30,12 +30,25 @@
 #include <stdbool.h>
 #endif
 
-struct jrpc_message;
+#ifndef __cplusplus
+#include <stddef.h>
+#include <stdint.h>
+#else
+#include <cstddef>
+#include <cstdint>
+using ::std::size_t;
+#endif
+
+#include "jrpc/message.h"
 
 struct jrpc_queue
 {
-    struct jrpc_message * first;
-    struct jrpc_message * last;
+    struct jrpc_message * * messages;
+    size_t capacity;
+    size_t first;
+    size_t count;
+    size_t bytes;
+    uint64_t head;
 };
 
 #ifdef __cplusplus
@@ -52,13 +65,29 @@ extern void jrpc_queue_cleanup(
 extern bool jrpc_queue_is_empty(
     struct jrpc_queue * queue);
 
-extern void jrpc_queue_append(
+extern bool jrpc_queue_append(
     struct jrpc_queue * queue,
     struct jrpc_message * message);
 
 extern struct jrpc_message * jrpc_queue_dequeue(
     struct jrpc_queue * queue);
 
+extern struct jrpc_message * jrpc_queue_remove_oldest(
+    struct jrpc_queue * queue,
+    enum jrpc_message_type type);
+
+extern uint64_t jrpc_queue_get_tail(
+    struct jrpc_queue const * queue);
+
+extern struct jrpc_message * jrpc_queue_get(
+    struct jrpc_queue const * queue,
+    uint64_t position);
+
+extern struct jrpc_message * jrpc_queue_replace(
+    struct jrpc_queue * queue,
+    uint64_t position,
+    struct jrpc_message * message);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,194 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/registry.h"
+
+#include <stdlib.h>
+
+#define JRPC_REGISTRY_INITIAL_CAPACITY 16
+#define JRPC_REGISTRY_NO_SLOT UINT32_MAX
+#define JRPC_REGISTRY_TAG_SHIFT 24
+#define JRPC_REGISTRY_INDEX_MASK ((UINT32_C(1) << JRPC_REGISTRY_TAG_SHIFT) - 1)
+#define JRPC_REGISTRY_MAX_SLOTS (JRPC_REGISTRY_INDEX_MASK + 1)
+
+// Handles combine the slot index (lower 24 bits) and the registry's tag
+// (next 8 bits) with the generation of the slot (upper 32 bits).
+// The generation is incremented whenever a slot is released, so stale
+// handles never resolve to a value that reuses the slot.
+// Generations start at 1; 0 is never a valid handle.
+// The lower 32 bits alone form a small id, which is reused once the
+// slot is released.
+// Occupied slots are additionally listed densely in active_slots, so
+// iteration costs O(active) instead of O(highest slot ever used).
+
+static uint64_t jrpc_registry_make_handle(
+    struct jrpc_registry const * registry,
+    uint32_t index,
+    uint32_t generation)
+{
+    return (((uint64_t) generation) << 32) | (registry->tag << JRPC_REGISTRY_TAG_SHIFT) | index;
+}
+
+void jrpc_registry_init(
+    struct jrpc_registry * registry,
+    uint32_t tag)
+{
+    registry->slots = NULL;
+    registry->active_slots = NULL;
+    registry->count = 0;
+    registry->active = 0;
+    registry->capacity = 0;
+    registry->first_free = JRPC_REGISTRY_NO_SLOT;
+    registry->tag = tag & 0xff;
+}
+
+void jrpc_registry_cleanup(
+    struct jrpc_registry * registry)
+{
+    free(registry->slots);
+    free(registry->active_slots);
+    jrpc_registry_init(registry, registry->tag);
+}
+
+uint64_t jrpc_registry_add(
+    struct jrpc_registry * registry,
+    void * value)
+{
+    uint32_t index = registry->first_free;
+    if (JRPC_REGISTRY_NO_SLOT != index)
+    {
+        registry->first_free = registry->slots[index].next_free;
+    }
+    else
+    {
+        if (JRPC_REGISTRY_MAX_SLOTS <= registry->count)
+        {
+            return 0;
+        }
+
+        if (registry->count == registry->capacity)
+        {
+            size_t const capacity = (0 < registry->capacity) ? (2 * registry->capacity) : JRPC_REGISTRY_INITIAL_CAPACITY;
+            struct jrpc_registry_slot * slots = realloc(registry->slots, capacity * sizeof(struct jrpc_registry_slot));
+            if (NULL == slots)
+            {
+                return 0;
+            }
+            registry->slots = slots;
+
+            uint32_t * active_slots = realloc(registry->active_slots, capacity * sizeof(uint32_t));
+            if (NULL == active_slots)
+            {
+                return 0;
+            }
+            registry->active_slots = active_slots;
+            registry->capacity = capacity;
+        }
+
+        index = (uint32_t) registry->count;
+        registry->slots[index].generation = 1;
+        registry->count++;
+    }
+
+    struct jrpc_registry_slot * slot = &registry->slots[index];
+    slot->value = value;
+    slot->next_free = JRPC_REGISTRY_NO_SLOT;
+    slot->active_index = (uint32_t) registry->active;
+    registry->active_slots[registry->active] = index;
+    registry->active++;
+
+    return jrpc_registry_make_handle(registry, index, slot->generation);
+}
+
+void jrpc_registry_remove(
+    struct jrpc_registry * registry,
+    uint64_t handle)
+{
+    if (NULL == jrpc_registry_resolve(registry, handle))
+    {
+        return;
+    }
+
+    uint32_t const index = (uint32_t) (handle & JRPC_REGISTRY_INDEX_MASK);
+    struct jrpc_registry_slot * slot = &registry->slots[index];
+
+    slot->value = NULL;
+    slot->generation++;
+    if (0 == slot->generation)
+    {
+        slot->generation = 1;
+    }
+
+    slot->next_free = registry->first_free;
+    registry->first_free = index;
+
+    registry->active--;
+    uint32_t const moved = registry->active_slots[registry->active];
+    registry->active_slots[slot->active_index] = moved;
+    registry->slots[moved].active_index = slot->active_index;
+}
+
+uint32_t jrpc_registry_get_tag(
+    uint64_t handle)
+{
+    return (uint32_t) ((handle >> JRPC_REGISTRY_TAG_SHIFT) & 0xff);
+}
+
+void * jrpc_registry_resolve(
+    struct jrpc_registry const * registry,
+    uint64_t handle)
+{
+    uint32_t const index = (uint32_t) (handle & JRPC_REGISTRY_INDEX_MASK);
+    uint32_t const generation = (uint32_t) (handle >> 32);
+
+    if ((index < registry->count) && (registry->tag == jrpc_registry_get_tag(handle)) &&
+        (generation == registry->slots[index].generation))
+    {
+        return registry->slots[index].value;
+    }
+
+    return NULL;
+}
+
+void * jrpc_registry_find(
+    struct jrpc_registry const * registry,
+    uint32_t id)
+{
+    uint32_t const index = id & JRPC_REGISTRY_INDEX_MASK;
+
+    if ((index < registry->count) && (registry->tag == (id >> JRPC_REGISTRY_TAG_SHIFT)))
+    {
+        return registry->slots[index].value;
+    }
+
+    return NULL;
+}
+
+void * jrpc_registry_get_active(
+    struct jrpc_registry const * registry,
+    size_t position)
+{
+    return (position < registry->active) ? registry->slots[registry->active_slots[position]].value : NULL;
+}
@@ -0,0 +1,96 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_REGISTRY_H
+#define JRPC_REGISTRY_H
+
+#ifndef __cplusplus
+#include <stddef.h>
+#include <stdint.h>
+#else
+#include <cstddef>
+#include <cstdint>
+using ::std::size_t;
+#endif
+
+struct jrpc_registry_slot
+{
+    void * value;
+    uint32_t generation;
+    uint32_t next_free;
+    uint32_t active_index;
+};
+
+struct jrpc_registry
+{
+    struct jrpc_registry_slot * slots;
+    uint32_t * active_slots;
+    size_t count;
+    size_t active;
+    size_t capacity;
+    uint32_t first_free;
+    uint32_t tag;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern void jrpc_registry_init(
+    struct jrpc_registry * registry,
+    uint32_t tag);
+
+extern void jrpc_registry_cleanup(
+    struct jrpc_registry * registry);
+
+extern uint64_t jrpc_registry_add(
+    struct jrpc_registry * registry,
+    void * value);
+
+extern void jrpc_registry_remove(
+    struct jrpc_registry * registry,
+    uint64_t handle);
+
+extern uint32_t jrpc_registry_get_tag(
+    uint64_t handle);
+
+extern void * jrpc_registry_resolve(
+    struct jrpc_registry const * registry,
+    uint64_t handle);
+
+extern void * jrpc_registry_find(
+    struct jrpc_registry const * registry,
+    uint32_t id);
+
+extern void * jrpc_registry_get_active(
+    struct jrpc_registry const * registry,
+    size_t position);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
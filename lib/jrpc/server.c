@@ -24,29 +24,35 @@
  */
 
 #include "jrpc/server.h"
+#include "jrpc/server_intern.h"
 #include "jrpc/protocol.h"
+#include "jrpc/loop.h"
+#include "jrpc/loop_timer.h"
+#include "jrpc/offload.h"
 
 #include <libwebsockets.h>
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <unistd.h>
 
 #define JRPC_DISABLE_LWS_LOG 0
-#define JRPC_SERVER_PROTOCOL_COUNT 3
+#define JRPC_SERVER_MAX_SERVICE_THREADS 256
 #define JRPC_SERVER_TIMEOUT (1 * 1000)
 
 #define JRPC_SERVER_DEFAULT_PORT 8080
 #define JRPC_SERVER_DEFAULT_PROTOCOL_NAME ("jrpc")
+#define JRPC_SERVER_BATCH_PROTOCOL_SUFFIX (".batch")
+#define JRPC_SERVER_DEFAULT_BATCH_MAX_BYTES (16 * 1024)
 
 struct jrpc_server
 {
     struct jrpc_protocol protocol;
-    struct lws_protocols ws_protocols[JRPC_SERVER_PROTOCOL_COUNT];
-    struct lws_http_mount mount;
-    struct lws_context_creation_info info;
-    struct lws_context * context;
+    bool is_started;
     char * protocol_name;
+    char * batch_protocol_name;
     char * document_root;
     char * cert_path;
     char * key_path;
@@ -54,50 +60,119 @@ struct jrpc_server
 };
 
 static struct lws_context * jrpc_server_create_context(
-    struct jrpc_server * server)
+    struct jrpc_server * server,
+    struct jrpc_loop * loop)
 {
     lws_set_log_level(JRPC_DISABLE_LWS_LOG, NULL);
 
-    memset(server->ws_protocols, 0, sizeof(struct lws_protocols) * JRPC_SERVER_PROTOCOL_COUNT);
-    server->ws_protocols[0].name = "http";
-    server->ws_protocols[0].callback = lws_callback_http_dummy;
-    server->ws_protocols[1].name = server->protocol_name;
-    jrpc_protocol_init_lws(&server->protocol, &server->ws_protocols[1]);
-
-    memset(&server->mount, 0, sizeof(struct lws_http_mount));
-    server->mount.mount_next = NULL;
-    server->mount.mountpoint = "/";
-    server->mount.origin = server->document_root;
-    server->mount.def = "index.html";
-    server->mount.origin_protocol = LWSMPRO_FILE;
-    server->mount.mountpoint_len = 1;
-
-    memset(&server->info, 0, sizeof(struct lws_context_creation_info));
-    server->info.port = server->port;
-    server->info.mounts = &server->mount;
-    server->info.protocols = server->ws_protocols;
-    server->info.vhost_name = "localhost";
-    server->info.ws_ping_pong_interval = 10;
-    server->info.options = LWS_SERVER_OPTION_HTTP_HEADERS_SECURITY_BEST_PRACTICES_ENFORCE;
+    memset(loop->ws_protocols, 0, sizeof(struct lws_protocols) * JRPC_LOOP_PROTOCOL_COUNT);
+    jrpc_protocol_init_lws_http(loop, &loop->ws_protocols[0]);
+    loop->ws_protocols[1].name = server->protocol_name;
+    jrpc_protocol_init_lws(loop, &loop->ws_protocols[1]);
+    if (NULL != server->batch_protocol_name)
+    {
+        // clients opt in to batched notifications by requesting this protocol
+        loop->ws_protocols[2].name = server->batch_protocol_name;
+        jrpc_protocol_init_lws(loop, &loop->ws_protocols[2]);
+        loop->ws_protocols[2].id = JRPC_PROTOCOL_ID_BATCH;
+    }
+
+    memset(&loop->mount, 0, sizeof(struct lws_http_mount));
+    loop->mount.mount_next = NULL;
+    loop->mount.mountpoint = "/";
+    loop->mount.origin = server->document_root;
+    loop->mount.def = "index.html";
+    loop->mount.origin_protocol = LWSMPRO_FILE;
+    loop->mount.mountpoint_len = 1;
+
+    memset(&loop->info, 0, sizeof(struct lws_context_creation_info));
+    loop->info.port = server->port;
+    loop->info.mounts = &loop->mount;
+    loop->info.protocols = loop->ws_protocols;
+    loop->info.vhost_name = "localhost";
+    loop->info.ws_ping_pong_interval = 10;
+    loop->info.user = loop;
+    loop->info.options = LWS_SERVER_OPTION_HTTP_HEADERS_SECURITY_BEST_PRACTICES_ENFORCE;
+
+    if (1 < server->protocol.loop_count)
+    {
+        // each loop listens on its own socket; the kernel distributes connections
+        loop->info.options |= LWS_SERVER_OPTION_ALLOW_LISTEN_SHARE;
+    }
 
     if (NULL == server->document_root)
     {
         // disable http
-        server->info.protocols = &server->ws_protocols[1];
-        server->info.mounts = NULL;
+        loop->info.protocols = &loop->ws_protocols[1];
+        loop->info.mounts = NULL;
     }
 
     if ((NULL != server->cert_path) && (NULL != server->key_path))
     {
-        server->info.options |= LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
-        server->info.ssl_cert_filepath = server->cert_path;
-        server->info.ssl_private_key_filepath = server->key_path;
+        loop->info.options |= LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
+        loop->info.ssl_cert_filepath = server->cert_path;
+        loop->info.ssl_private_key_filepath = server->key_path;
     }
 
-    struct lws_context * context = lws_create_context(&server->info);
+    struct lws_context * context = lws_create_context(&loop->info);
     return context;
 }
 
+bool jrpc_server_start(
+    struct jrpc_server * server)
+{
+    struct jrpc_protocol * protocol = &server->protocol;
+    if (server->is_started)
+    {
+        return true;
+    }
+
+    if ((0 < protocol->batch_window_ms) && (NULL == server->batch_protocol_name))
+    {
+        size_t const length = strlen(server->protocol_name) + strlen(JRPC_SERVER_BATCH_PROTOCOL_SUFFIX) + 1;
+        server->batch_protocol_name = malloc(length);
+        if (NULL != server->batch_protocol_name)
+        {
+            snprintf(server->batch_protocol_name, length, "%s%s", server->protocol_name, JRPC_SERVER_BATCH_PROTOCOL_SUFFIX);
+        }
+    }
+
+    // without loop 0 the server is not started, so the next call tries again
+    struct jrpc_loop * main_loop = &protocol->loops[0];
+    main_loop->context = jrpc_server_create_context(server, main_loop);
+    if (NULL == main_loop->context)
+    {
+        return false;
+    }
+
+    server->is_started = true;
+    jrpc_method_table_freeze(&protocol->methods);
+    jrpc_method_table_freeze(&protocol->notifications);
+    if (protocol->uses_workers)
+    {
+        jrpc_worker_pool_start(&protocol->workers);
+    }
+
+    for(size_t i = 1; i < protocol->loop_count; i++)
+    {
+        protocol->loops[i].context = jrpc_server_create_context(server, &protocol->loops[i]);
+    }
+
+    // loop 0 is serviced by the thread calling jrpc_server_run
+    jrpc_loop_attach(main_loop);
+    long const cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    for(size_t i = 1; i < protocol->loop_count; i++)
+    {
+        struct jrpc_loop * loop = &protocol->loops[i];
+        int const cpu = ((protocol->use_cpu_affinity) && (0 < cpu_count)) ? (int) (i % (size_t) cpu_count) : -1;
+        if (NULL != loop->context)
+        {
+            jrpc_loop_start(loop, cpu);
+        }
+    }
+
+    return true;
+}
 
 struct jrpc_server * jrpc_server_create(void)
 {
@@ -106,11 +181,12 @@ struct jrpc_server * jrpc_server_create(void)
     {
         jrpc_server_protocol_init(&server->protocol, server);
         server->protocol_name = strdup(JRPC_SERVER_DEFAULT_PROTOCOL_NAME);
+        server->batch_protocol_name = NULL;
         server->document_root = NULL;
         server->cert_path = NULL;
         server->key_path = NULL;
         server->port = JRPC_SERVER_DEFAULT_PORT;
-        server->context = NULL;
+        server->is_started = false;
     }
 
     return server;
@@ -119,13 +195,9 @@ struct jrpc_server * jrpc_server_create(void)
 void jrpc_server_dispose(
     struct jrpc_server * server)
 {
-    if (NULL != server->context)
-    {
-        lws_context_destroy(server->context);
-    }
-
     jrpc_protocol_cleanup(&server->protocol);
     free(server->protocol_name);
+    free(server->batch_protocol_name);
     free(server->document_root);
     free(server->cert_path);
     free(server->key_path);
@@ -153,6 +225,134 @@ void jrpc_server_set_onnotify(
     server->protocol.onnotify = handler;
 }
 
+void jrpc_server_set_onmethod_raw(
+    struct jrpc_server * server,
+    jrpc_invoke_raw_fn * handler)
+{
+    server->protocol.onmethod_raw = handler;
+}
+
+void jrpc_server_set_onnotify_raw(
+    struct jrpc_server * server,
+    jrpc_notify_raw_fn * handler)
+{
+    server->protocol.onnotify_raw = handler;
+}
+
+void jrpc_server_register_method(
+    struct jrpc_server * server,
+    char const * method_name,
+    jrpc_method_fn * handler,
+    void * user_data)
+{
+    // the method tables are shared by all loops and frozen on start
+    if (server->is_started)
+    {
+        return;
+    }
+
+    union jrpc_method_handler method_handler;
+    method_handler.method = handler;
+    jrpc_method_table_add(&server->protocol.methods, method_name, JRPC_METHOD_JSON, method_handler, user_data);
+}
+
+void jrpc_server_register_method_raw(
+    struct jrpc_server * server,
+    char const * method_name,
+    jrpc_method_raw_fn * handler,
+    void * user_data)
+{
+    if (server->is_started)
+    {
+        return;
+    }
+
+    union jrpc_method_handler method_handler;
+    method_handler.method_raw = handler;
+    jrpc_method_table_add(&server->protocol.methods, method_name, JRPC_METHOD_RAW, method_handler, user_data);
+}
+
+void jrpc_server_register_method_offloaded(
+    struct jrpc_server * server,
+    char const * method_name,
+    jrpc_offloaded_method_fn * handler,
+    void * user_data)
+{
+    if (server->is_started)
+    {
+        return;
+    }
+
+    union jrpc_method_handler method_handler;
+    method_handler.offloaded = handler;
+    jrpc_method_table_add(&server->protocol.methods, method_name, JRPC_METHOD_OFFLOADED, method_handler, user_data);
+    server->protocol.uses_workers = true;
+}
+
+void jrpc_server_set_worker_threads(
+    struct jrpc_server * server,
+    size_t thread_count)
+{
+    jrpc_worker_pool_set_threads(&server->protocol.workers, thread_count);
+    server->protocol.uses_workers = true;
+}
+
+bool jrpc_server_offload(
+    struct jrpc_server * server,
+    jrpc_work_fn * work,
+    jrpc_work_done_fn * done,
+    void * user_data)
+{
+    struct jrpc_protocol * protocol = &server->protocol;
+    struct jrpc_loop * loop = jrpc_protocol_get_current_loop(protocol);
+    if (NULL == loop)
+    {
+        // the loop is only the target of the done post
+        loop = &protocol->loops[0];
+    }
+
+    return jrpc_offload_work_submit(protocol, loop, work, done, user_data);
+}
+
+void jrpc_server_get_worker_pool_stats(
+    struct jrpc_server * server,
+    struct jrpc_worker_pool_stats * stats)
+{
+    jrpc_worker_pool_get_stats(&server->protocol.workers, stats);
+}
+
+void jrpc_server_register_notification(
+    struct jrpc_server * server,
+    char const * method_name,
+    jrpc_notification_fn * handler,
+    void * user_data)
+{
+    if (server->is_started)
+    {
+        return;
+    }
+
+    union jrpc_method_handler method_handler;
+    method_handler.notification = handler;
+    jrpc_method_table_add(&server->protocol.notifications, method_name, JRPC_METHOD_JSON, method_handler, user_data);
+}
+
+void jrpc_server_register_notification_raw(
+    struct jrpc_server * server,
+    char const * method_name,
+    jrpc_notification_raw_fn * handler,
+    void * user_data)
+{
+    if (server->is_started)
+    {
+        return;
+    }
+
+    union jrpc_method_handler method_handler;
+    method_handler.notification_raw = handler;
+    jrpc_method_table_add(&server->protocol.notifications, method_name, JRPC_METHOD_RAW, method_handler, user_data);
+}
+
 void jrpc_server_set_onconnected(
     struct jrpc_server * server,
     jrpc_connected_fn * handler)
@@ -212,23 +412,296 @@ void * jrpc_server_get_userdata(
     return server->protocol.user_data;
 }
 
+void jrpc_server_set_message_pool_limits(
+    struct jrpc_server * server,
+    size_t max_messages_per_class,
+    size_t max_bytes)
+{
+    for(size_t i = 0; i < server->protocol.loop_count; i++)
+    {
+        jrpc_message_pool_set_limits(&server->protocol.loops[i].pool, max_messages_per_class, max_bytes);
+    }
+}
+
+void jrpc_server_get_message_pool_stats(
+    struct jrpc_server * server,
+    struct jrpc_message_pool_stats * stats)
+{
+    memset(stats, 0, sizeof(struct jrpc_message_pool_stats));
+    for(size_t i = 0; i < server->protocol.loop_count; i++)
+    {
+        struct jrpc_message_pool_stats loop_stats;
+        jrpc_message_pool_get_stats(&server->protocol.loops[i].pool, &loop_stats);
+
+        stats->hits += loop_stats.hits;
+        stats->misses += loop_stats.misses;
+        stats->bytes_retained += loop_stats.bytes_retained;
+        stats->messages_retained += loop_stats.messages_retained;
+    }
+}
+
+void jrpc_server_set_write_budget(
+    struct jrpc_server * server,
+    size_t max_messages,
+    size_t max_bytes)
+{
+    server->protocol.write_max_messages = (0 < max_messages) ? max_messages : 1;
+    server->protocol.write_max_bytes = (0 < max_bytes) ? max_bytes : 1;
+}
+
+void jrpc_server_set_fragment_size(
+    struct jrpc_server * server,
+    size_t fragment_size)
+{
+    // the fragment buffers of the loops are sized on first use
+    if (server->is_started)
+    {
+        return;
+    }
+
+    server->protocol.fragment_size = fragment_size;
+}
+
+void jrpc_server_get_write_stats(
+    struct jrpc_server * server,
+    struct jrpc_write_stats * stats)
+{
+    memset(stats, 0, sizeof(struct jrpc_write_stats));
+    for(size_t i = 0; i < server->protocol.loop_count; i++)
+    {
+        struct jrpc_write_stats const * loop_stats = &server->protocol.loops[i].write_stats;
+
+        stats->writeable_callbacks += loop_stats->writeable_callbacks;
+        stats->messages_sent += loop_stats->messages_sent;
+        stats->bytes_sent += loop_stats->bytes_sent;
+        stats->fragments_sent += loop_stats->fragments_sent;
+        if (loop_stats->max_messages_per_callback > stats->max_messages_per_callback)
+        {
+            stats->max_messages_per_callback = loop_stats->max_messages_per_callback;
+        }
+    }
+}
+
+struct jrpc_protocol * jrpc_server_get_protocol(
+    struct jrpc_server * server)
+{
+    return &server->protocol;
+}
+
+void jrpc_server_set_max_message_size(
+    struct jrpc_server * server,
+    size_t max_message_size)
+{
+    server->protocol.max_message_size = max_message_size;
+}
+
+void jrpc_server_set_outbound_limit(
+    struct jrpc_server * server,
+    size_t max_bytes,
+    size_t max_messages,
+    enum jrpc_overflow_policy policy)
+{
+    server->protocol.outbound_max_bytes = max_bytes;
+    server->protocol.outbound_max_messages = max_messages;
+    server->protocol.overflow_policy = policy;
+}
+
+void jrpc_server_set_outbound_watermarks(
+    struct jrpc_server * server,
+    size_t low_watermark,
+    size_t high_watermark)
+{
+    server->protocol.low_watermark = low_watermark;
+    server->protocol.high_watermark = high_watermark;
+}
+
+void jrpc_server_set_onhighwatermark(
+    struct jrpc_server * server,
+    jrpc_watermark_fn * handler)
+{
+    server->protocol.onhighwatermark = handler;
+}
+
+void jrpc_server_set_onlowwatermark(
+    struct jrpc_server * server,
+    jrpc_watermark_fn * handler)
+{
+    server->protocol.onlowwatermark = handler;
+}
+
+void jrpc_server_set_priority_weight(
+    struct jrpc_server * server,
+    size_t weight)
+{
+    server->protocol.priority_weight = (0 < weight) ? weight : 1;
+}
+
+void jrpc_server_set_request_timeout(
+    struct jrpc_server * server,
+    unsigned int timeout_ms)
+{
+    server->protocol.request_timeout_ms = timeout_ms;
+    server->protocol.is_tracking_requests = (0 < timeout_ms) || (server->protocol.is_cancellation_enabled);
+}
+
+void jrpc_server_set_notification_batching(
+    struct jrpc_server * server,
+    unsigned int window_us,
+    size_t max_bytes)
+{
+    // timers of the loop have a resolution of one millisecond
+    server->protocol.batch_window_ms = (window_us + 999) / 1000;
+    server->protocol.batch_max_bytes = (0 < max_bytes) ? max_bytes : JRPC_SERVER_DEFAULT_BATCH_MAX_BYTES;
+}
+
+void jrpc_server_set_request_cancellation(
+    struct jrpc_server * server,
+    bool enabled)
+{
+    server->protocol.is_cancellation_enabled = enabled;
+    server->protocol.is_tracking_requests = (0 < server->protocol.request_timeout_ms) || (enabled);
+}
+
+void jrpc_server_set_oncancel(
+    struct jrpc_server * server,
+    jrpc_cancel_fn * handler)
+{
+    server->protocol.oncancel = handler;
+}
+
+size_t jrpc_server_get_pending_requests(
+    struct jrpc_server * server)
+{
+    size_t count = 0;
+    for(size_t i = 0; i < server->protocol.loop_count; i++)
+    {
+        count += server->protocol.loops[i].pending_requests;
+    }
+
+    return count;
+}
+
+void jrpc_server_set_service_threads(
+    struct jrpc_server * server,
+    size_t thread_count)
+{
+    if (server->is_started)
+    {
+        return;
+    }
+
+    if (0 == thread_count)
+    {
+        thread_count = 1;
+    }
+    else if (JRPC_SERVER_MAX_SERVICE_THREADS < thread_count)
+    {
+        thread_count = JRPC_SERVER_MAX_SERVICE_THREADS;
+    }
+
+    jrpc_protocol_set_loops(&server->protocol, thread_count);
+}
+
+void jrpc_server_set_cpu_affinity(
+    struct jrpc_server * server,
+    bool enabled)
+{
+    server->protocol.use_cpu_affinity = enabled;
+}
+
 void jrpc_server_run(
     struct jrpc_server * server,
     int timeout_ms)
 {
-    if (NULL == server->context)
+    if (jrpc_server_start(server))
     {
-        server->context = jrpc_server_create_context(server);
+        jrpc_loop_service(&server->protocol.loops[0], timeout_ms);
     }
+}
+
+void jrpc_server_set_onpoll(
+    struct jrpc_server * server,
+    jrpc_poll_fn * handler,
+    void * user_data)
+{
+    server->protocol.onpoll = handler;
+    server->protocol.poll_user_data = user_data;
+}
 
-    if (NULL != server->context)
+void jrpc_server_service_fd(
+    struct jrpc_server * server,
+    int fd,
+    int revents)
+{
+    struct jrpc_loop * loop = &server->protocol.loops[0];
+    if (NULL != loop->context)
+    {
+        jrpc_loop_service_fd(loop, fd, revents);
+    }
+}
+
+int jrpc_server_get_timeout(
+    struct jrpc_server * server,
+    int max_timeout_ms)
+{
+    struct jrpc_loop * loop = &server->protocol.loops[0];
+    if (NULL == loop->context)
+    {
+        return max_timeout_ms;
+    }
+
+    int timeout_ms = lws_service_adjust_timeout(loop->context, max_timeout_ms, 0);
+
+    // lws does not know about the loop's timers
+    uint64_t const deadline = loop->timer_deadline;
+    if ((0 != timeout_ms) && (0 != deadline))
+    {
+        uint64_t const now = jrpc_loop_now_ms();
+        uint64_t const remaining = (deadline > now) ? (deadline - now) : 0;
+        if ((0 > timeout_ms) || (remaining < (uint64_t) timeout_ms))
+        {
+            timeout_ms = (int) remaining;
+        }
+    }
+
+    return timeout_ms;
+}
+
+void jrpc_server_service_timers(
+    struct jrpc_server * server)
+{
+    struct jrpc_loop * loop = &server->protocol.loops[0];
+    if (NULL != loop->context)
+    {
+        jrpc_loop_service_timers(loop);
+    }
+}
+
+jrpc_timer_id jrpc_server_add_timer(
+    struct jrpc_server * server,
+    unsigned int timeout_ms,
+    unsigned int interval_ms,
+    jrpc_timer_fn * handler,
+    void * user_data)
+{
+    struct jrpc_loop * loop = jrpc_protocol_get_current_loop(&server->protocol);
+
+    return (NULL != loop) ? jrpc_loop_timer_add(loop, timeout_ms, interval_ms, handler, user_data) : 0;
+}
+
+void jrpc_server_cancel_timer(
+    struct jrpc_server * server,
+    jrpc_timer_id id)
+{
+    struct jrpc_loop * loop = jrpc_protocol_get_loop(&server->protocol, id);
+    if (NULL != loop)
     {
-        lws_service(server->context, timeout_ms);
+        jrpc_loop_timer_cancel(loop, id);
     }
 }
 
 void jrpc_server_wakeup(
     struct jrpc_server * server)
 {
-    jrpc_protocol_wakeup(&server->protocol);
+    jrpc_loop_wakeup(&server->protocol.loops[0]);
 }
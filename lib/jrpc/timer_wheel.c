@@ -0,0 +1,209 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/timer_wheel.h"
+
+#include <string.h>
+
+#define JRPC_TIMER_WHEEL_MASK ((uint64_t) (JRPC_TIMER_WHEEL_SLOTS - 1))
+#define JRPC_TIMER_WHEEL_MAX_DELTA ((UINT64_C(1) << (JRPC_TIMER_WHEEL_BITS * JRPC_TIMER_WHEEL_LEVELS)) - 1)
+
+// Hierarchical timing wheel: level 0 holds timers due within the next
+// 256 ticks, each further level covers 256 times the range of the level
+// below. Whenever level 0 wraps around, the due slot of the next level
+// is cascaded down. Add and cancel are O(1).
+
+static void jrpc_timer_wheel_place(
+    struct jrpc_timer_wheel * wheel,
+    struct jrpc_timer * timer,
+    bool is_cascade)
+{
+    // while cascading, the current tick is about to be processed;
+    // otherwise it is already done and due timers fire on the next tick
+    uint64_t const earliest = (is_cascade) ? wheel->current : (wheel->current + 1);
+
+    uint64_t expires = timer->expires;
+    if (expires < earliest)
+    {
+        expires = earliest;
+    }
+    else if (expires - wheel->current > JRPC_TIMER_WHEEL_MAX_DELTA)
+    {
+        expires = wheel->current + JRPC_TIMER_WHEEL_MAX_DELTA;
+    }
+
+    uint64_t const delta = expires - wheel->current;
+    size_t level = 0;
+    while ((level + 1 < JRPC_TIMER_WHEEL_LEVELS) &&
+        (delta >= (UINT64_C(1) << (JRPC_TIMER_WHEEL_BITS * (level + 1)))))
+    {
+        level++;
+    }
+
+    size_t const index = (size_t) ((expires >> (JRPC_TIMER_WHEEL_BITS * level)) & JRPC_TIMER_WHEEL_MASK);
+    struct jrpc_timer * * head = &wheel->slots[level][index];
+
+    timer->next = *head;
+    timer->prev_link = head;
+    if (NULL != timer->next)
+    {
+        timer->next->prev_link = &timer->next;
+    }
+    *head = timer;
+}
+
+static void jrpc_timer_wheel_unlink(
+    struct jrpc_timer * timer)
+{
+    *timer->prev_link = timer->next;
+    if (NULL != timer->next)
+    {
+        timer->next->prev_link = timer->prev_link;
+    }
+
+    timer->next = NULL;
+    timer->prev_link = NULL;
+}
+
+static void jrpc_timer_wheel_cascade(
+    struct jrpc_timer_wheel * wheel,
+    size_t level)
+{
+    size_t const index = (size_t) ((wheel->current >> (JRPC_TIMER_WHEEL_BITS * level)) & JRPC_TIMER_WHEEL_MASK);
+
+    if ((0 == index) && (level + 1 < JRPC_TIMER_WHEEL_LEVELS))
+    {
+        jrpc_timer_wheel_cascade(wheel, level + 1);
+    }
+
+    struct jrpc_timer * timer = wheel->slots[level][index];
+    wheel->slots[level][index] = NULL;
+
+    while (NULL != timer)
+    {
+        struct jrpc_timer * next = timer->next;
+        jrpc_timer_wheel_place(wheel, timer, true);
+        timer = next;
+    }
+}
+
+void jrpc_timer_wheel_init(
+    struct jrpc_timer_wheel * wheel,
+    uint64_t now)
+{
+    memset(wheel->slots, 0, sizeof(wheel->slots));
+    wheel->current = now;
+    wheel->count = 0;
+}
+
+void jrpc_timer_init(
+    struct jrpc_timer * timer,
+    jrpc_timer_callback_fn * callback)
+{
+    timer->next = NULL;
+    timer->prev_link = NULL;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->is_pending = false;
+}
+
+void jrpc_timer_wheel_add(
+    struct jrpc_timer_wheel * wheel,
+    struct jrpc_timer * timer,
+    uint64_t expires)
+{
+    jrpc_timer_wheel_cancel(wheel, timer);
+
+    timer->expires = expires;
+    timer->is_pending = true;
+    jrpc_timer_wheel_place(wheel, timer, false);
+    wheel->count++;
+}
+
+void jrpc_timer_wheel_cancel(
+    struct jrpc_timer_wheel * wheel,
+    struct jrpc_timer * timer)
+{
+    if (timer->is_pending)
+    {
+        jrpc_timer_wheel_unlink(timer);
+        timer->is_pending = false;
+        wheel->count--;
+    }
+}
+
+void jrpc_timer_wheel_advance(
+    struct jrpc_timer_wheel * wheel,
+    uint64_t now)
+{
+    while (wheel->current < now)
+    {
+        if (0 == wheel->count)
+        {
+            wheel->current = now;
+            break;
+        }
+
+        wheel->current++;
+        size_t const index = (size_t) (wheel->current & JRPC_TIMER_WHEEL_MASK);
+        if (0 == index)
+        {
+            jrpc_timer_wheel_cascade(wheel, 1);
+        }
+
+        // pop one by one: callbacks may add or cancel other timers
+        struct jrpc_timer * * head = &wheel->slots[0][index];
+        while (NULL != *head)
+        {
+            struct jrpc_timer * timer = *head;
+            jrpc_timer_wheel_unlink(timer);
+            timer->is_pending = false;
+            wheel->count--;
+
+            timer->callback(timer);
+        }
+    }
+}
+
+int64_t jrpc_timer_wheel_next_timeout(
+    struct jrpc_timer_wheel const * wheel)
+{
+    if (0 == wheel->count)
+    {
+        return -1;
+    }
+
+    for(int64_t ticks = 1; ticks <= JRPC_TIMER_WHEEL_SLOTS; ticks++)
+    {
+        size_t const index = (size_t) ((wheel->current + (uint64_t) ticks) & JRPC_TIMER_WHEEL_MASK);
+        if ((0 == index) || (NULL != wheel->slots[0][index]))
+        {
+            // either a timer is due or higher levels must be cascaded
+            return ticks;
+        }
+    }
+
+    return JRPC_TIMER_WHEEL_SLOTS;
+}
@@ -0,0 +1,97 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_TIMER_WHEEL_H
+#define JRPC_TIMER_WHEEL_H
+
+#ifndef __cplusplus
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#else
+#include <cstddef>
+#include <cstdint>
+using ::std::size_t;
+#endif
+
+#define JRPC_TIMER_WHEEL_LEVELS 4
+#define JRPC_TIMER_WHEEL_BITS 8
+#define JRPC_TIMER_WHEEL_SLOTS (1 << JRPC_TIMER_WHEEL_BITS)
+
+struct jrpc_timer;
+
+typedef void jrpc_timer_callback_fn(
+    struct jrpc_timer * timer);
+
+struct jrpc_timer
+{
+    struct jrpc_timer * next;
+    struct jrpc_timer * * prev_link;
+    uint64_t expires;
+    jrpc_timer_callback_fn * callback;
+    bool is_pending;
+};
+
+struct jrpc_timer_wheel
+{
+    struct jrpc_timer * slots[JRPC_TIMER_WHEEL_LEVELS][JRPC_TIMER_WHEEL_SLOTS];
+    uint64_t current;
+    size_t count;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern void jrpc_timer_wheel_init(
+    struct jrpc_timer_wheel * wheel,
+    uint64_t now);
+
+extern void jrpc_timer_init(
+    struct jrpc_timer * timer,
+    jrpc_timer_callback_fn * callback);
+
+extern void jrpc_timer_wheel_add(
+    struct jrpc_timer_wheel * wheel,
+    struct jrpc_timer * timer,
+    uint64_t expires);
+
+extern void jrpc_timer_wheel_cancel(
+    struct jrpc_timer_wheel * wheel,
+    struct jrpc_timer * timer);
+
+extern void jrpc_timer_wheel_advance(
+    struct jrpc_timer_wheel * wheel,
+    uint64_t now);
+
+extern int64_t jrpc_timer_wheel_next_timeout(
+    struct jrpc_timer_wheel const * wheel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,338 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/topic.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define JRPC_TOPICS_INITIAL_BUCKETS 16
+#define JRPC_TOPIC_INITIAL_CAPACITY 4
+
+static size_t jrpc_topics_bucket(
+    size_t bucket_count,
+    char const * name)
+{
+    uint32_t hash = UINT32_C(2166136261);
+    for(unsigned char const * c = (unsigned char const *) name; '\0' != *c; c++)
+    {
+        hash ^= *c;
+        hash *= UINT32_C(16777619);
+    }
+
+    return hash & (bucket_count - 1);
+}
+
+static bool jrpc_topics_grow(
+    struct jrpc_topics * topics)
+{
+    size_t const bucket_count = (0 < topics->bucket_count) ? (2 * topics->bucket_count) : JRPC_TOPICS_INITIAL_BUCKETS;
+    struct jrpc_topic * * buckets = calloc(bucket_count, sizeof(struct jrpc_topic *));
+    if (NULL == buckets)
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < topics->bucket_count; i++)
+    {
+        struct jrpc_topic * topic = topics->buckets[i];
+        while (NULL != topic)
+        {
+            struct jrpc_topic * next = topic->next;
+            size_t const bucket = jrpc_topics_bucket(bucket_count, topic->name);
+            topic->next = buckets[bucket];
+            buckets[bucket] = topic;
+            topic = next;
+        }
+    }
+
+    free(topics->buckets);
+    topics->buckets = buckets;
+    topics->bucket_count = bucket_count;
+
+    return true;
+}
+
+static struct jrpc_topic * jrpc_topics_create(
+    struct jrpc_topics * topics,
+    char const * name)
+{
+    if ((topics->count >= topics->bucket_count) && (!jrpc_topics_grow(topics)))
+    {
+        return NULL;
+    }
+
+    struct jrpc_topic * topic = malloc(sizeof(struct jrpc_topic));
+    if (NULL == topic)
+    {
+        return NULL;
+    }
+
+    topic->name = strdup(name);
+    if (NULL == topic->name)
+    {
+        free(topic);
+        return NULL;
+    }
+
+    topic->subscribers = NULL;
+    topic->count = 0;
+    topic->capacity = 0;
+
+    size_t const bucket = jrpc_topics_bucket(topics->bucket_count, name);
+    topic->next = topics->buckets[bucket];
+    topics->buckets[bucket] = topic;
+    topics->count++;
+
+    return topic;
+}
+
+static void jrpc_topic_dispose(
+    struct jrpc_topic * topic)
+{
+    free(topic->subscribers);
+    free(topic->name);
+    free(topic);
+}
+
+static void jrpc_topics_remove(
+    struct jrpc_topics * topics,
+    struct jrpc_topic * topic)
+{
+    struct jrpc_topic * * link = &topics->buckets[jrpc_topics_bucket(topics->bucket_count, topic->name)];
+    while (topic != *link)
+    {
+        link = &(*link)->next;
+    }
+
+    *link = topic->next;
+    topics->count--;
+    jrpc_topic_dispose(topic);
+}
+
+static void * jrpc_topics_reserve(
+    void * items,
+    size_t * capacity,
+    size_t count,
+    size_t item_size)
+{
+    if (count < *capacity)
+    {
+        return items;
+    }
+
+    size_t const new_capacity = (0 < *capacity) ? (2 * *capacity) : JRPC_TOPIC_INITIAL_CAPACITY;
+    void * new_items = realloc(items, new_capacity * item_size);
+    if (NULL != new_items)
+    {
+        *capacity = new_capacity;
+    }
+
+    return new_items;
+}
+
+// Topics and subscriptions refer to each other by index, so both sides
+// are removed by swapping in their last element in O(1).
+static void jrpc_topics_remove_subscription(
+    struct jrpc_topics * topics,
+    struct jrpc_subscriptions * subscriptions,
+    size_t index)
+{
+    struct jrpc_subscription const subscription = subscriptions->items[index];
+    struct jrpc_topic * topic = subscription.topic;
+
+    topic->count--;
+    if (subscription.subscriber != topic->count)
+    {
+        struct jrpc_topic_subscriber const moved = topic->subscribers[topic->count];
+        topic->subscribers[subscription.subscriber] = moved;
+        moved.subscriptions->items[moved.subscription].subscriber = subscription.subscriber;
+    }
+
+    subscriptions->count--;
+    if (index != subscriptions->count)
+    {
+        struct jrpc_subscription const moved = subscriptions->items[subscriptions->count];
+        subscriptions->items[index] = moved;
+        moved.topic->subscribers[moved.subscriber].subscription = index;
+    }
+
+    if (0 == topic->count)
+    {
+        jrpc_topics_remove(topics, topic);
+    }
+}
+
+void jrpc_topics_init(
+    struct jrpc_topics * topics)
+{
+    topics->buckets = NULL;
+    topics->bucket_count = 0;
+    topics->count = 0;
+}
+
+void jrpc_topics_cleanup(
+    struct jrpc_topics * topics)
+{
+    for(size_t i = 0; i < topics->bucket_count; i++)
+    {
+        struct jrpc_topic * topic = topics->buckets[i];
+        while (NULL != topic)
+        {
+            struct jrpc_topic * next = topic->next;
+            jrpc_topic_dispose(topic);
+            topic = next;
+        }
+    }
+
+    free(topics->buckets);
+    jrpc_topics_init(topics);
+}
+
+struct jrpc_topic * jrpc_topics_get(
+    struct jrpc_topics const * topics,
+    char const * name)
+{
+    if (0 == topics->count)
+    {
+        return NULL;
+    }
+
+    struct jrpc_topic * topic = topics->buckets[jrpc_topics_bucket(topics->bucket_count, name)];
+    while ((NULL != topic) && (0 != strcmp(name, topic->name)))
+    {
+        topic = topic->next;
+    }
+
+    return topic;
+}
+
+bool jrpc_topics_subscribe(
+    struct jrpc_topics * topics,
+    struct jrpc_subscriptions * subscriptions,
+    struct jrpc_connection * connection,
+    char const * name)
+{
+    struct jrpc_topic * topic = jrpc_topics_get(topics, name);
+    if (NULL != topic)
+    {
+        for(size_t i = 0; i < subscriptions->count; i++)
+        {
+            if (topic == subscriptions->items[i].topic)
+            {
+                return true;
+            }
+        }
+    }
+    else
+    {
+        topic = jrpc_topics_create(topics, name);
+        if (NULL == topic)
+        {
+            return false;
+        }
+    }
+
+    struct jrpc_topic_subscriber * subscribers = jrpc_topics_reserve(topic->subscribers, &topic->capacity,
+        topic->count, sizeof(struct jrpc_topic_subscriber));
+    if (NULL != subscribers)
+    {
+        topic->subscribers = subscribers;
+    }
+
+    struct jrpc_subscription * items = jrpc_topics_reserve(subscriptions->items, &subscriptions->capacity,
+        subscriptions->count, sizeof(struct jrpc_subscription));
+    if (NULL != items)
+    {
+        subscriptions->items = items;
+    }
+
+    if ((NULL == subscribers) || (NULL == items))
+    {
+        if (0 == topic->count)
+        {
+            jrpc_topics_remove(topics, topic);
+        }
+
+        return false;
+    }
+
+    struct jrpc_topic_subscriber * subscriber = &topic->subscribers[topic->count];
+    subscriber->connection = connection;
+    subscriber->subscriptions = subscriptions;
+    subscriber->subscription = subscriptions->count;
+
+    struct jrpc_subscription * subscription = &subscriptions->items[subscriptions->count];
+    subscription->topic = topic;
+    subscription->subscriber = topic->count;
+
+    topic->count++;
+    subscriptions->count++;
+
+    return true;
+}
+
+void jrpc_topics_unsubscribe(
+    struct jrpc_topics * topics,
+    struct jrpc_subscriptions * subscriptions,
+    char const * name)
+{
+    struct jrpc_topic const * topic = jrpc_topics_get(topics, name);
+    if (NULL == topic)
+    {
+        return;
+    }
+
+    for(size_t i = 0; i < subscriptions->count; i++)
+    {
+        if (topic == subscriptions->items[i].topic)
+        {
+            jrpc_topics_remove_subscription(topics, subscriptions, i);
+            break;
+        }
+    }
+}
+
+void jrpc_topics_unsubscribe_all(
+    struct jrpc_topics * topics,
+    struct jrpc_subscriptions * subscriptions)
+{
+    while (0 < subscriptions->count)
+    {
+        jrpc_topics_remove_subscription(topics, subscriptions, subscriptions->count - 1);
+    }
+
+    free(subscriptions->items);
+    jrpc_subscriptions_init(subscriptions);
+}
+
+void jrpc_subscriptions_init(
+    struct jrpc_subscriptions * subscriptions)
+{
+    subscriptions->items = NULL;
+    subscriptions->count = 0;
+    subscriptions->capacity = 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_TOPIC_H
+#define JRPC_TOPIC_H
+
+#ifndef __cplusplus
+#include <stddef.h>
+#include <stdbool.h>
+#else
+#include <cstddef>
+using ::std::size_t;
+#endif
+
+struct jrpc_connection;
+struct jrpc_subscriptions;
+
+struct jrpc_topic_subscriber
+{
+    struct jrpc_connection * connection;
+    struct jrpc_subscriptions * subscriptions;
+    size_t subscription;
+};
+
+struct jrpc_topic
+{
+    struct jrpc_topic * next;
+    char * name;
+    struct jrpc_topic_subscriber * subscribers;
+    size_t count;
+    size_t capacity;
+};
+
+struct jrpc_topics
+{
+    struct jrpc_topic * * buckets;
+    size_t bucket_count;
+    size_t count;
+};
+
+struct jrpc_subscription
+{
+    struct jrpc_topic * topic;
+    size_t subscriber;
+};
+
+struct jrpc_subscriptions
+{
+    struct jrpc_subscription * items;
+    size_t count;
+    size_t capacity;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern void jrpc_topics_init(
+    struct jrpc_topics * topics);
+
+extern void jrpc_topics_cleanup(
+    struct jrpc_topics * topics);
+
+extern struct jrpc_topic * jrpc_topics_get(
+    struct jrpc_topics const * topics,
+    char const * name);
+
+extern bool jrpc_topics_subscribe(
+    struct jrpc_topics * topics,
+    struct jrpc_subscriptions * subscriptions,
+    struct jrpc_connection * connection,
+    char const * name);
+
+extern void jrpc_topics_unsubscribe(
+    struct jrpc_topics * topics,
+    struct jrpc_subscriptions * subscriptions,
+    char const * name);
+
+extern void jrpc_topics_unsubscribe_all(
+    struct jrpc_topics * topics,
+    struct jrpc_subscriptions * subscriptions);
+
+extern void jrpc_subscriptions_init(
+    struct jrpc_subscriptions * subscriptions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
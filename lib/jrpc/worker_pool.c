@@ -0,0 +1,214 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "jrpc/worker_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t jrpc_worker_pool_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (((uint64_t) now.tv_sec) * 1000 * 1000 * 1000) + ((uint64_t) now.tv_nsec);
+}
+
+static void * jrpc_worker_pool_run(
+    void * arg)
+{
+    struct jrpc_worker_pool * pool = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    while (true)
+    {
+        while ((!pool->is_stopping) && (NULL == pool->first))
+        {
+            pthread_cond_wait(&pool->condition, &pool->lock);
+        }
+
+        if (pool->is_stopping)
+        {
+            break;
+        }
+
+        struct jrpc_worker_job * job = pool->first;
+        pool->first = job->next;
+        if (NULL == pool->first)
+        {
+            pool->last = NULL;
+        }
+
+        uint64_t const wait_us = (jrpc_worker_pool_now_ns() - job->enqueued_ns) / 1000;
+        pool->stats.queue_depth--;
+        pool->stats.total_wait_us += wait_us;
+        if (wait_us > pool->stats.max_wait_us)
+        {
+            pool->stats.max_wait_us = wait_us;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        job->run(job);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->stats.jobs_completed++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+void jrpc_worker_pool_init(
+    struct jrpc_worker_pool * pool,
+    size_t thread_count)
+{
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->condition, NULL);
+    pool->threads = NULL;
+    pool->thread_count = thread_count;
+    pool->running_threads = 0;
+    pool->first = NULL;
+    pool->last = NULL;
+    pool->is_stopping = false;
+    memset(&pool->stats, 0, sizeof(struct jrpc_worker_pool_stats));
+}
+
+void jrpc_worker_pool_cleanup(
+    struct jrpc_worker_pool * pool)
+{
+    jrpc_worker_pool_stop(pool);
+    pthread_cond_destroy(&pool->condition);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+void jrpc_worker_pool_set_threads(
+    struct jrpc_worker_pool * pool,
+    size_t thread_count)
+{
+    pool->thread_count = (0 < thread_count) ? thread_count : 1;
+}
+
+bool jrpc_worker_pool_start(
+    struct jrpc_worker_pool * pool)
+{
+    if (0 < pool->running_threads)
+    {
+        return true;
+    }
+
+    pool->threads = malloc(pool->thread_count * sizeof(pthread_t));
+    if (NULL == pool->threads)
+    {
+        return false;
+    }
+
+    pool->is_stopping = false;
+    for(size_t i = 0; i < pool->thread_count; i++)
+    {
+        if (0 != pthread_create(&pool->threads[i], NULL, &jrpc_worker_pool_run, pool))
+        {
+            break;
+        }
+
+        pool->running_threads++;
+    }
+
+    pool->stats.threads = pool->running_threads;
+    return (0 < pool->running_threads);
+}
+
+void jrpc_worker_pool_stop(
+    struct jrpc_worker_pool * pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->is_stopping = true;
+    pthread_cond_broadcast(&pool->condition);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(size_t i = 0; i < pool->running_threads; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    free(pool->threads);
+    pool->threads = NULL;
+    pool->running_threads = 0;
+    pool->stats.threads = 0;
+
+    while (NULL != pool->first)
+    {
+        struct jrpc_worker_job * job = pool->first;
+        pool->first = job->next;
+        job->discard(job);
+    }
+
+    pool->last = NULL;
+    pool->stats.queue_depth = 0;
+}
+
+bool jrpc_worker_pool_submit(
+    struct jrpc_worker_pool * pool,
+    struct jrpc_worker_job * job)
+{
+    if (0 == pool->running_threads)
+    {
+        return false;
+    }
+
+    job->next = NULL;
+    job->enqueued_ns = jrpc_worker_pool_now_ns();
+
+    pthread_mutex_lock(&pool->lock);
+    if (NULL != pool->last)
+    {
+        pool->last->next = job;
+    }
+    else
+    {
+        pool->first = job;
+    }
+    pool->last = job;
+
+    pool->stats.queue_depth++;
+    if (pool->stats.queue_depth > pool->stats.max_queue_depth)
+    {
+        pool->stats.max_queue_depth = pool->stats.queue_depth;
+    }
+
+    pthread_cond_signal(&pool->condition);
+    pthread_mutex_unlock(&pool->lock);
+
+    return true;
+}
+
+void jrpc_worker_pool_get_stats(
+    struct jrpc_worker_pool * pool,
+    struct jrpc_worker_pool_stats * stats)
+{
+    pthread_mutex_lock(&pool->lock);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,102 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_WORKER_POOL_H
+#define JRPC_WORKER_POOL_H
+
+#include "jrpc/server.h"
+#include <pthread.h>
+
+#ifndef __cplusplus
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#else
+#include <cstddef>
+#include <cstdint>
+using ::std::size_t;
+#endif
+
+struct jrpc_worker_job;
+
+typedef void jrpc_worker_job_fn(
+    struct jrpc_worker_job * job);
+
+struct jrpc_worker_job
+{
+    struct jrpc_worker_job * next;
+    jrpc_worker_job_fn * run;
+    jrpc_worker_job_fn * discard;
+    uint64_t enqueued_ns;
+};
+
+struct jrpc_worker_pool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t condition;
+    pthread_t * threads;
+    size_t thread_count;
+    size_t running_threads;
+    struct jrpc_worker_job * first;
+    struct jrpc_worker_job * last;
+    bool is_stopping;
+    struct jrpc_worker_pool_stats stats;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern void jrpc_worker_pool_init(
+    struct jrpc_worker_pool * pool,
+    size_t thread_count);
+
+extern void jrpc_worker_pool_cleanup(
+    struct jrpc_worker_pool * pool);
+
+extern void jrpc_worker_pool_set_threads(
+    struct jrpc_worker_pool * pool,
+    size_t thread_count);
+
+extern bool jrpc_worker_pool_start(
+    struct jrpc_worker_pool * pool);
+
+extern void jrpc_worker_pool_stop(
+    struct jrpc_worker_pool * pool);
+
+extern bool jrpc_worker_pool_submit(
+    struct jrpc_worker_pool * pool,
+    struct jrpc_worker_job * job);
+
+extern void jrpc_worker_pool_get_stats(
+    struct jrpc_worker_pool * pool,
+    struct jrpc_worker_pool_stats * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "test_check.h"
+#include "test_client.h"
+
+#include <jrpc/server.h>
+#include <jrpc/connection.h>
+#include <jansson.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define TEST_PORT 54322
+#define TEST_MAX_DEFERRED 16
+
+struct test_deferred
+{
+    struct jrpc_connection * connection;
+    int ids[TEST_MAX_DEFERRED];
+    size_t count;
+};
+
+static atomic_bool test_is_stopping;
+
+// server side: requests are answered only when asked to by "flush"
+
+static void test_defer(
+    struct jrpc_connection * connection,
+    json_t * params,
+    int id,
+    void * user_data)
+{
+    (void) params;
+    struct test_deferred * deferred = user_data;
+
+    deferred->connection = connection;
+    deferred->ids[deferred->count++] = id;
+}
+
+static void test_flush(
+    struct jrpc_connection * connection,
+    json_t * params,
+    int id,
+    void * user_data)
+{
+    (void) params;
+    struct test_deferred * deferred = user_data;
+
+    for(size_t i = 0; i < deferred->count; i++)
+    {
+        jrpc_respond(deferred->connection, json_string("deferred"), deferred->ids[i]);
+    }
+    deferred->count = 0;
+
+    jrpc_respond(connection, json_string("flushed"), id);
+}
+
+static bool test_is_response(
+    json_t const * message,
+    int id,
+    char const * result)
+{
+    json_t * result_holder = json_object_get(message, "result");
+    return ((json_is_string(result_holder)) && (0 == strcmp(result, json_string_value(result_holder))) &&
+        (id == json_integer_value(json_object_get(message, "id"))));
+}
+
+static bool test_is_invalid_request(
+    json_t const * message,
+    int id)
+{
+    json_t * error = json_object_get(message, "error");
+    return ((JRPC_INVALID_REQUEST_ERROR_CODE == json_integer_value(json_object_get(error, "code"))) &&
+        (id == json_integer_value(json_object_get(message, "id"))));
+}
+
+static void test_duplicate_request(
+    struct test_client * client)
+{
+    test_client_send(client, "{\"method\":\"defer\",\"params\":[],\"id\":1}");
+    test_client_send(client, "{\"method\":\"defer\",\"params\":[],\"id\":1}");
+    test_client_receive(client, 1);
+
+    TEST_CHECK(1 == client->message_count);
+    TEST_CHECK((1 <= client->message_count) && (test_is_invalid_request(client->messages[0], 1)));
+    test_client_clear(client);
+
+    // the first request is still answered
+    test_client_send(client, "{\"method\":\"flush\",\"params\":[],\"id\":2}");
+    test_client_receive(client, 2);
+
+    TEST_CHECK(2 == client->message_count);
+    TEST_CHECK((2 <= client->message_count) && (test_is_response(client->messages[0], 1, "deferred")));
+    TEST_CHECK((2 <= client->message_count) && (test_is_response(client->messages[1], 2, "flushed")));
+    test_client_clear(client);
+}
+
+static void test_duplicate_request_in_batch(
+    struct test_client * client)
+{
+    test_client_send(client, "[{\"method\":\"defer\",\"params\":[],\"id\":3},{\"method\":\"defer\",\"params\":[],\"id\":3}]");
+    test_client_send(client, "{\"method\":\"flush\",\"params\":[],\"id\":4}");
+    test_client_receive(client, 2);
+
+    // the batch is complete once the first request is answered
+    TEST_CHECK(2 == client->message_count);
+    json_t * batch = (2 <= client->message_count) ? client->messages[0] : NULL;
+    TEST_CHECK((json_is_array(batch)) && (2 == json_array_size(batch)));
+    TEST_CHECK((json_is_array(batch)) && (test_is_invalid_request(json_array_get(batch, 0), 3)));
+    TEST_CHECK((json_is_array(batch)) && (test_is_response(json_array_get(batch, 1), 3, "deferred")));
+    TEST_CHECK((2 <= client->message_count) && (test_is_response(client->messages[1], 4, "flushed")));
+    test_client_clear(client);
+}
+
+static void * test_run_client(
+    void * arg)
+{
+    struct jrpc_server * server = arg;
+
+    struct test_client client;
+    bool const is_connected = test_client_connect(&client, TEST_PORT);
+    TEST_CHECK(is_connected);
+    if (is_connected)
+    {
+        test_duplicate_request(&client);
+        test_duplicate_request_in_batch(&client);
+    }
+    test_client_close(&client);
+
+    atomic_store(&test_is_stopping, true);
+    jrpc_server_wakeup(server);
+
+    return NULL;
+}
+
+int main(void)
+{
+    struct test_deferred deferred;
+    deferred.connection = NULL;
+    deferred.count = 0;
+
+    struct jrpc_server * server = jrpc_server_create();
+    jrpc_server_set_port(server, TEST_PORT);
+    jrpc_server_set_request_timeout(server, 10 * 1000);
+    jrpc_server_register_method(server, "defer", &test_defer, &deferred);
+    jrpc_server_register_method(server, "flush", &test_flush, &deferred);
+    if (!jrpc_server_start(server))
+    {
+        TEST_CHECK(false);
+        jrpc_server_dispose(server);
+        return EXIT_FAILURE;
+    }
+
+    pthread_t thread;
+    atomic_init(&test_is_stopping, false);
+    pthread_create(&thread, NULL, &test_run_client, server);
+    while (!atomic_load(&test_is_stopping))
+    {
+        jrpc_server_run(server, 10);
+    }
+    pthread_join(thread, NULL);
+    jrpc_server_dispose(server);
+
+    return (0 == test_failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,160 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "test_check.h"
+
+#include <jrpc/server.h>
+
+#include <poll.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#define TEST_PORT 54321
+#define TEST_MAX_TIMEOUT_MS (10 * 1000)
+
+static uint64_t test_now_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (((uint64_t) now.tv_sec) * 1000) + (((uint64_t) now.tv_nsec) / (1000 * 1000));
+}
+
+static void test_onpoll(
+    int fd,
+    enum jrpc_poll_action action,
+    int events,
+    void * user_data)
+{
+    (void) fd;
+    (void) action;
+    (void) events;
+    (void) user_data;
+}
+
+static void test_ontimer(
+    struct jrpc_server * server,
+    jrpc_timer_id id,
+    void * user_data)
+{
+    (void) server;
+    (void) id;
+
+    size_t * fired = user_data;
+    (*fired)++;
+}
+
+// drives the server like an external event loop without ready descriptors
+static size_t test_wait_for(
+    struct jrpc_server * server,
+    size_t const * fired,
+    size_t expected)
+{
+    size_t iterations = 0;
+    while ((*fired < expected) && (iterations < 100))
+    {
+        int const timeout_ms = jrpc_server_get_timeout(server, TEST_MAX_TIMEOUT_MS);
+        TEST_CHECK(TEST_MAX_TIMEOUT_MS > timeout_ms);
+
+        poll(NULL, 0, timeout_ms);
+        jrpc_server_service_timers(server);
+        iterations++;
+    }
+
+    return iterations;
+}
+
+static void test_one_shot_timer(
+    struct jrpc_server * server)
+{
+    size_t fired = 0;
+    uint64_t const start = test_now_ms();
+
+    jrpc_timer_id const id = jrpc_server_add_timer(server, 50, 0, &test_ontimer, &fired);
+    TEST_CHECK(0 != id);
+    TEST_CHECK(50 >= jrpc_server_get_timeout(server, TEST_MAX_TIMEOUT_MS));
+    TEST_CHECK(0 <= jrpc_server_get_timeout(server, -1));
+
+    size_t const iterations = test_wait_for(server, &fired, 1);
+    uint64_t const elapsed = test_now_ms() - start;
+
+    TEST_CHECK(1 == fired);
+    TEST_CHECK(50 <= elapsed);
+    TEST_CHECK(1000 > elapsed);
+    TEST_CHECK(10 > iterations);
+}
+
+static void test_periodic_timer(
+    struct jrpc_server * server)
+{
+    size_t fired = 0;
+    uint64_t const start = test_now_ms();
+
+    jrpc_timer_id const id = jrpc_server_add_timer(server, 20, 20, &test_ontimer, &fired);
+    TEST_CHECK(0 != id);
+
+    test_wait_for(server, &fired, 3);
+    uint64_t const elapsed = test_now_ms() - start;
+    jrpc_server_cancel_timer(server, id);
+
+    TEST_CHECK(3 == fired);
+    TEST_CHECK(60 <= elapsed);
+    TEST_CHECK(1000 > elapsed);
+}
+
+static void test_start_on_used_port(void)
+{
+    struct jrpc_server * server = jrpc_server_create();
+    jrpc_server_set_port(server, TEST_PORT);
+    jrpc_server_set_onpoll(server, &test_onpoll, NULL);
+
+    // a failed start is reported each time, instead of only the first one
+    TEST_CHECK(!jrpc_server_start(server));
+    TEST_CHECK(!jrpc_server_start(server));
+
+    jrpc_server_dispose(server);
+}
+
+int main(void)
+{
+    struct jrpc_server * server = jrpc_server_create();
+    jrpc_server_set_port(server, TEST_PORT);
+    jrpc_server_set_onpoll(server, &test_onpoll, NULL);
+    TEST_CHECK(jrpc_server_start(server));
+    TEST_CHECK(jrpc_server_start(server));
+
+    // no timer armed: only lws limits the timeout
+    TEST_CHECK(TEST_MAX_TIMEOUT_MS == jrpc_server_get_timeout(server, TEST_MAX_TIMEOUT_MS));
+
+    test_one_shot_timer(server);
+    test_periodic_timer(server);
+    test_start_on_used_port();
+
+    jrpc_server_dispose(server);
+
+    return (0 == test_failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,143 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "test_check.h"
+
+#include "jrpc/method_table.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void test_method(
+    struct jrpc_connection * connection,
+    json_t * params,
+    int id,
+    void * user_data)
+{
+    (void) connection;
+    (void) params;
+    (void) id;
+    (void) user_data;
+}
+
+static void test_add(
+    struct jrpc_method_table * table,
+    char const * name,
+    uintptr_t value)
+{
+    union jrpc_method_handler handler;
+    handler.method = &test_method;
+    jrpc_method_table_add(table, name, JRPC_METHOD_JSON, handler, (void *) value);
+}
+
+static bool test_finds(
+    struct jrpc_method_table const * table,
+    char const * name,
+    uintptr_t value)
+{
+    struct jrpc_method_entry const * entry = jrpc_method_table_lookup(table, name);
+    return ((NULL != entry) && ((void *) value == entry->user_data));
+}
+
+static void test_perfect_hash(
+    size_t count)
+{
+    struct jrpc_method_table table;
+    jrpc_method_table_init(&table);
+
+    char name[32];
+    for(size_t i = 0; i < count; i++)
+    {
+        snprintf(name, sizeof(name), "method_%zu", i);
+        test_add(&table, name, i + 1);
+    }
+
+    jrpc_method_table_freeze(&table);
+    TEST_CHECK(table.is_frozen);
+    TEST_CHECK(count == table.slot_count);
+
+    for(size_t i = 0; i < count; i++)
+    {
+        snprintf(name, sizeof(name), "method_%zu", i);
+        TEST_CHECK(test_finds(&table, name, i + 1));
+    }
+
+    // unknown names map to some slot, but must not match its entry
+    for(size_t i = count; i < (4 * count); i++)
+    {
+        snprintf(name, sizeof(name), "method_%zu", i);
+        TEST_CHECK(NULL == jrpc_method_table_lookup(&table, name));
+    }
+    TEST_CHECK(NULL == jrpc_method_table_lookup(&table, ""));
+
+    jrpc_method_table_cleanup(&table);
+}
+
+static void test_replace_and_add_after_freeze(void)
+{
+    struct jrpc_method_table table;
+    jrpc_method_table_init(&table);
+
+    TEST_CHECK(NULL == jrpc_method_table_lookup(&table, "any"));
+    jrpc_method_table_freeze(&table);
+    TEST_CHECK(!table.is_frozen);
+
+    test_add(&table, "add", 1);
+    test_add(&table, "sub", 2);
+    test_add(&table, "add", 3);
+    TEST_CHECK(2 == table.count);
+    TEST_CHECK(test_finds(&table, "add", 3));
+
+    jrpc_method_table_freeze(&table);
+    TEST_CHECK(table.is_frozen);
+
+    // replacing keeps the perfect hash
+    test_add(&table, "sub", 4);
+    TEST_CHECK(table.is_frozen);
+    TEST_CHECK(test_finds(&table, "sub", 4));
+
+    // adding falls back to open addressing
+    test_add(&table, "mul", 5);
+    TEST_CHECK(!table.is_frozen);
+    TEST_CHECK(test_finds(&table, "add", 3));
+    TEST_CHECK(test_finds(&table, "sub", 4));
+    TEST_CHECK(test_finds(&table, "mul", 5));
+    TEST_CHECK(NULL == jrpc_method_table_lookup(&table, "div"));
+
+    jrpc_method_table_cleanup(&table);
+}
+
+int main(void)
+{
+    test_perfect_hash(1);
+    test_perfect_hash(2);
+    test_perfect_hash(7);
+    test_perfect_hash(100);
+    test_perfect_hash(5000);
+    test_replace_and_add_after_freeze();
+
+    return (0 == test_failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,213 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "test_check.h"
+#include "test_client.h"
+
+#include <jrpc/server.h>
+#include <jrpc/connection.h>
+#include <jansson.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define TEST_PORT 54323
+#define TEST_CLIENT_COUNT 3
+#define TEST_TOPIC "news"
+
+static atomic_bool test_is_stopping;
+static atomic_size_t test_unsubscribed;
+static bool test_is_publishing = false;
+
+// server side: a congested subscriber is unsubscribed while the topic is published
+
+static void test_onhighwatermark(
+    struct jrpc_connection * connection)
+{
+    if (test_is_publishing)
+    {
+        jrpc_unsubscribe(connection, TEST_TOPIC);
+        atomic_fetch_add(&test_unsubscribed, 1);
+    }
+}
+
+static void test_subscribe(
+    struct jrpc_connection * connection,
+    json_t * params,
+    int id,
+    void * user_data)
+{
+    (void) params;
+    (void) user_data;
+
+    jrpc_respond(connection, json_boolean(jrpc_subscribe(connection, TEST_TOPIC)), id);
+}
+
+static void test_publish(
+    struct jrpc_connection * connection,
+    json_t * params,
+    int id,
+    void * user_data)
+{
+    (void) params;
+    struct jrpc_server * server = user_data;
+
+    test_is_publishing = true;
+    jrpc_publish(server, TEST_TOPIC, TEST_TOPIC, json_array());
+    test_is_publishing = false;
+
+    jrpc_respond(connection, json_true(), id);
+}
+
+static void test_ping(
+    struct jrpc_connection * connection,
+    json_t * params,
+    int id,
+    void * user_data)
+{
+    (void) params;
+    (void) user_data;
+
+    jrpc_respond(connection, json_true(), id);
+}
+
+// client side
+
+static size_t test_count_notifications(
+    struct test_client const * client)
+{
+    size_t count = 0;
+    for(size_t i = 0; i < client->message_count; i++)
+    {
+        json_t * method = json_object_get(client->messages[i], "method");
+        if ((json_is_string(method)) && (0 == strcmp(TEST_TOPIC, json_string_value(method))))
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static void test_unsubscribe_on_highwatermark(
+    struct test_client * clients)
+{
+    for(size_t i = 0; i < TEST_CLIENT_COUNT; i++)
+    {
+        test_client_send(&clients[i], "{\"method\":\"subscribe\",\"params\":[],\"id\":1}");
+        test_client_receive(&clients[i], 1);
+        TEST_CHECK(1 == clients[i].message_count);
+        test_client_clear(&clients[i]);
+    }
+
+    // every subscriber is reached, although each one unsubscribes during the fanout
+    test_client_send(&clients[0], "{\"method\":\"publish\",\"params\":[],\"id\":2}");
+    test_client_receive(&clients[0], 2);
+    for(size_t i = 1; i < TEST_CLIENT_COUNT; i++)
+    {
+        test_client_receive(&clients[i], 1);
+    }
+
+    for(size_t i = 0; i < TEST_CLIENT_COUNT; i++)
+    {
+        TEST_CHECK(1 == test_count_notifications(&clients[i]));
+        test_client_clear(&clients[i]);
+    }
+    TEST_CHECK(TEST_CLIENT_COUNT == atomic_load(&test_unsubscribed));
+
+    // the topic has no subscribers left
+    test_client_send(&clients[0], "{\"method\":\"publish\",\"params\":[],\"id\":3}");
+    test_client_receive(&clients[0], 1);
+    for(size_t i = 0; i < TEST_CLIENT_COUNT; i++)
+    {
+        test_client_send(&clients[i], "{\"method\":\"ping\",\"params\":[],\"id\":4}");
+        test_client_receive(&clients[i], (0 == i) ? 2 : 1);
+        TEST_CHECK(0 == test_count_notifications(&clients[i]));
+        test_client_clear(&clients[i]);
+    }
+    TEST_CHECK(TEST_CLIENT_COUNT == atomic_load(&test_unsubscribed));
+}
+
+static void * test_run_clients(
+    void * arg)
+{
+    struct jrpc_server * server = arg;
+
+    struct test_client clients[TEST_CLIENT_COUNT];
+    bool is_connected = true;
+    for(size_t i = 0; i < TEST_CLIENT_COUNT; i++)
+    {
+        is_connected = (test_client_connect(&clients[i], TEST_PORT)) && (is_connected);
+    }
+
+    TEST_CHECK(is_connected);
+    if (is_connected)
+    {
+        test_unsubscribe_on_highwatermark(clients);
+    }
+
+    for(size_t i = 0; i < TEST_CLIENT_COUNT; i++)
+    {
+        test_client_close(&clients[i]);
+    }
+
+    atomic_store(&test_is_stopping, true);
+    jrpc_server_wakeup(server);
+
+    return NULL;
+}
+
+int main(void)
+{
+    struct jrpc_server * server = jrpc_server_create();
+    jrpc_server_set_port(server, TEST_PORT);
+    jrpc_server_set_outbound_watermarks(server, 0, 1);
+    jrpc_server_set_onhighwatermark(server, &test_onhighwatermark);
+    jrpc_server_register_method(server, "subscribe", &test_subscribe, NULL);
+    jrpc_server_register_method(server, "publish", &test_publish, server);
+    jrpc_server_register_method(server, "ping", &test_ping, NULL);
+    if (!jrpc_server_start(server))
+    {
+        TEST_CHECK(false);
+        jrpc_server_dispose(server);
+        return EXIT_FAILURE;
+    }
+
+    pthread_t thread;
+    atomic_init(&test_is_stopping, false);
+    atomic_init(&test_unsubscribed, 0);
+    pthread_create(&thread, NULL, &test_run_clients, server);
+    while (!atomic_load(&test_is_stopping))
+    {
+        jrpc_server_run(server, 10);
+    }
+    pthread_join(thread, NULL);
+    jrpc_server_dispose(server);
+
+    return (0 == test_failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
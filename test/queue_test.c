@@ -0,0 +1,252 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "test_check.h"
+
+#include "jrpc/queue.h"
+#include "jrpc/conflation.h"
+#include "jrpc/message.h"
+#include "jrpc/message_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static struct jrpc_message_pool test_pool;
+
+static struct jrpc_message * test_message(
+    char const * data,
+    enum jrpc_message_type type)
+{
+    return jrpc_message_create_copy(&test_pool, data, strlen(data), type);
+}
+
+static size_t test_sum_bytes(
+    struct jrpc_queue const * queue)
+{
+    size_t bytes = 0;
+    for(uint64_t position = queue->head; position < jrpc_queue_get_tail(queue); position++)
+    {
+        bytes += jrpc_queue_get(queue, position)->length;
+    }
+
+    return bytes;
+}
+
+static void test_positions_survive_growth(void)
+{
+    struct jrpc_queue queue;
+    jrpc_queue_init(&queue);
+
+    // wrap around before growing, so that growing has to unwrap
+    for(size_t i = 0; i < 6; i++)
+    {
+        jrpc_queue_append(&queue, test_message("n", JRPC_MESSAGE_NOTIFICATION));
+    }
+    for(size_t i = 0; i < 4; i++)
+    {
+        jrpc_message_dispose(jrpc_queue_dequeue(&queue));
+    }
+
+    struct jrpc_message * messages[32];
+    uint64_t positions[32];
+    for(size_t i = 0; i < 32; i++)
+    {
+        positions[i] = jrpc_queue_get_tail(&queue);
+        messages[i] = test_message("message", JRPC_MESSAGE_NOTIFICATION);
+        TEST_CHECK(jrpc_queue_append(&queue, messages[i]));
+    }
+
+    for(size_t i = 0; i < 32; i++)
+    {
+        TEST_CHECK(messages[i] == jrpc_queue_get(&queue, positions[i]));
+    }
+    TEST_CHECK(NULL == jrpc_queue_get(&queue, queue.head - 1));
+    TEST_CHECK(NULL == jrpc_queue_get(&queue, jrpc_queue_get_tail(&queue)));
+    TEST_CHECK(test_sum_bytes(&queue) == queue.bytes);
+
+    jrpc_queue_cleanup(&queue);
+    TEST_CHECK(0 == queue.bytes);
+}
+
+static void test_remove_oldest_keeps_notification_positions(void)
+{
+    struct jrpc_queue queue;
+    jrpc_queue_init(&queue);
+
+    struct jrpc_message * response = test_message("response", JRPC_MESSAGE_RESPONSE);
+    struct jrpc_message * oldest = test_message("oldest", JRPC_MESSAGE_NOTIFICATION);
+    struct jrpc_message * newest = test_message("newest", JRPC_MESSAGE_NOTIFICATION);
+    jrpc_queue_append(&queue, response);
+    uint64_t const oldest_position = jrpc_queue_get_tail(&queue);
+    jrpc_queue_append(&queue, oldest);
+    uint64_t const newest_position = jrpc_queue_get_tail(&queue);
+    jrpc_queue_append(&queue, newest);
+
+    TEST_CHECK(oldest == jrpc_queue_remove_oldest(&queue, JRPC_MESSAGE_NOTIFICATION));
+    jrpc_message_dispose(oldest);
+
+    // the response before the removed notification moved into its position
+    TEST_CHECK(newest == jrpc_queue_get(&queue, newest_position));
+    TEST_CHECK(response == jrpc_queue_get(&queue, oldest_position));
+    TEST_CHECK(2 == queue.count);
+    TEST_CHECK(test_sum_bytes(&queue) == queue.bytes);
+
+    TEST_CHECK(response == jrpc_queue_remove_oldest(&queue, JRPC_MESSAGE_RESPONSE));
+    jrpc_message_dispose(response);
+    TEST_CHECK(newest == jrpc_queue_get(&queue, newest_position));
+    TEST_CHECK(NULL == jrpc_queue_remove_oldest(&queue, JRPC_MESSAGE_RESPONSE));
+
+    jrpc_queue_cleanup(&queue);
+}
+
+static void test_replace_accounts_bytes(void)
+{
+    struct jrpc_queue queue;
+    jrpc_queue_init(&queue);
+
+    jrpc_queue_append(&queue, test_message("first", JRPC_MESSAGE_NOTIFICATION));
+    uint64_t const position = jrpc_queue_get_tail(&queue);
+    struct jrpc_message * old_value = test_message("short", JRPC_MESSAGE_NOTIFICATION);
+    jrpc_queue_append(&queue, old_value);
+    jrpc_queue_append(&queue, test_message("last", JRPC_MESSAGE_NOTIFICATION));
+
+    struct jrpc_message * new_value = test_message("a much longer value", JRPC_MESSAGE_NOTIFICATION);
+    TEST_CHECK(old_value == jrpc_queue_replace(&queue, position, new_value));
+    jrpc_message_dispose(old_value);
+    TEST_CHECK(new_value == jrpc_queue_get(&queue, position));
+    TEST_CHECK(test_sum_bytes(&queue) == queue.bytes);
+
+    // positions outside of the queue are not replaced
+    struct jrpc_message * other = test_message("other", JRPC_MESSAGE_NOTIFICATION);
+    TEST_CHECK(NULL == jrpc_queue_replace(&queue, jrpc_queue_get_tail(&queue), other));
+    jrpc_message_dispose(jrpc_queue_dequeue(&queue));
+    TEST_CHECK(NULL == jrpc_queue_replace(&queue, position - 1, other));
+    jrpc_message_dispose(other);
+
+    while (!jrpc_queue_is_empty(&queue))
+    {
+        jrpc_message_dispose(jrpc_queue_dequeue(&queue));
+    }
+    TEST_CHECK(0 == queue.bytes);
+
+    jrpc_queue_cleanup(&queue);
+}
+
+static void test_conflation_replaces_after_drop_oldest(void)
+{
+    struct jrpc_queue queue;
+    struct jrpc_conflation conflation;
+    jrpc_queue_init(&queue);
+    jrpc_conflation_init(&conflation);
+
+    jrpc_queue_append(&queue, test_message("response", JRPC_MESSAGE_RESPONSE));
+    jrpc_queue_append(&queue, test_message("dropped", JRPC_MESSAGE_NOTIFICATION));
+    uint64_t const position = jrpc_queue_get_tail(&queue);
+    struct jrpc_message * first = test_message("first", JRPC_MESSAGE_NOTIFICATION);
+    jrpc_queue_append(&queue, first);
+    TEST_CHECK(jrpc_conflation_set(&conflation, &queue, "key", position, first));
+
+    // dropping an older notification does not invalidate the entry
+    jrpc_message_dispose(jrpc_queue_remove_oldest(&queue, JRPC_MESSAGE_NOTIFICATION));
+    struct jrpc_conflation_entry * entry = jrpc_conflation_get(&conflation, "key");
+    TEST_CHECK((NULL != entry) && (entry->message == jrpc_queue_get(&queue, entry->position)));
+
+    struct jrpc_message * second = test_message("second value", JRPC_MESSAGE_NOTIFICATION);
+    jrpc_message_dispose(jrpc_queue_replace(&queue, entry->position, second));
+    entry->message = second;
+    TEST_CHECK(second == jrpc_queue_get(&queue, position));
+    TEST_CHECK(test_sum_bytes(&queue) == queue.bytes);
+
+    // dropping the conflated notification itself makes the entry stale
+    TEST_CHECK(second == jrpc_queue_remove_oldest(&queue, JRPC_MESSAGE_NOTIFICATION));
+    TEST_CHECK(entry->message != jrpc_queue_get(&queue, entry->position));
+    jrpc_message_dispose(second);
+
+    jrpc_conflation_cleanup(&conflation);
+    jrpc_queue_cleanup(&queue);
+}
+
+static void test_conflation_purges_stale_entries(void)
+{
+    struct jrpc_queue queue;
+    struct jrpc_conflation conflation;
+    jrpc_queue_init(&queue);
+    jrpc_conflation_init(&conflation);
+
+    char key[16];
+    for(size_t i = 0; i < 24; i++)
+    {
+        snprintf(key, sizeof(key), "key-%zu", i);
+        uint64_t const position = jrpc_queue_get_tail(&queue);
+        struct jrpc_message * message = test_message(key, JRPC_MESSAGE_NOTIFICATION);
+        jrpc_queue_append(&queue, message);
+        TEST_CHECK(jrpc_conflation_set(&conflation, &queue, key, position, message));
+
+        // entries of the first 8 keys become stale, when their messages are sent
+        if (i < 8)
+        {
+            jrpc_message_dispose(jrpc_queue_dequeue(&queue));
+        }
+    }
+
+    // stale entries were purged instead of growing the table
+    TEST_CHECK(16 == conflation.bucket_count);
+    TEST_CHECK(16 == conflation.count);
+    TEST_CHECK(NULL == jrpc_conflation_get(&conflation, "key-0"));
+
+    for(size_t i = 8; i < 24; i++)
+    {
+        snprintf(key, sizeof(key), "key-%zu", i);
+        struct jrpc_conflation_entry const * entry = jrpc_conflation_get(&conflation, key);
+        TEST_CHECK((NULL != entry) && (entry->message == jrpc_queue_get(&queue, entry->position)));
+    }
+
+    // without stale entries, the table grows
+    uint64_t const position = jrpc_queue_get_tail(&queue);
+    struct jrpc_message * message = test_message("key-24", JRPC_MESSAGE_NOTIFICATION);
+    jrpc_queue_append(&queue, message);
+    TEST_CHECK(jrpc_conflation_set(&conflation, &queue, "key-24", position, message));
+    TEST_CHECK(32 == conflation.bucket_count);
+    TEST_CHECK(17 == conflation.count);
+
+    jrpc_conflation_cleanup(&conflation);
+    jrpc_queue_cleanup(&queue);
+}
+
+int main(void)
+{
+    jrpc_message_pool_init(&test_pool);
+
+    test_positions_survive_growth();
+    test_remove_oldest_keeps_notification_positions();
+    test_replace_accounts_bytes();
+    test_conflation_replaces_after_drop_oldest();
+    test_conflation_purges_stale_entries();
+
+    jrpc_message_pool_cleanup(&test_pool);
+
+    return (0 == test_failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,111 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "test_check.h"
+
+#include "jrpc/registry.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define TEST_VALUE_COUNT 100
+
+static bool test_is_active(
+    struct jrpc_registry const * registry,
+    void * value)
+{
+    for(size_t i = 0; i < registry->active; i++)
+    {
+        if (value == jrpc_registry_get_active(registry, i))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void test_active_slots(void)
+{
+    struct jrpc_registry registry;
+    jrpc_registry_init(&registry, 3);
+
+    int values[TEST_VALUE_COUNT];
+    uint64_t handles[TEST_VALUE_COUNT];
+    for(size_t i = 0; i < TEST_VALUE_COUNT; i++)
+    {
+        handles[i] = jrpc_registry_add(&registry, &values[i]);
+        TEST_CHECK(0 != handles[i]);
+        TEST_CHECK(3 == jrpc_registry_get_tag(handles[i]));
+    }
+
+    // remove every value but each third one
+    for(size_t i = 0; i < TEST_VALUE_COUNT; i++)
+    {
+        if (0 != (i % 3))
+        {
+            jrpc_registry_remove(&registry, handles[i]);
+        }
+    }
+
+    TEST_CHECK(((TEST_VALUE_COUNT + 2) / 3) == registry.active);
+    for(size_t i = 0; i < TEST_VALUE_COUNT; i++)
+    {
+        bool const is_kept = (0 == (i % 3));
+        TEST_CHECK(is_kept == test_is_active(&registry, &values[i]));
+        TEST_CHECK((is_kept ? &values[i] : NULL) == jrpc_registry_resolve(&registry, handles[i]));
+    }
+    TEST_CHECK(NULL == jrpc_registry_get_active(&registry, registry.active));
+
+    // released slots are reused, stale handles stay invalid
+    int other;
+    uint64_t const handle = jrpc_registry_add(&registry, &other);
+    TEST_CHECK(handle != handles[TEST_VALUE_COUNT - 2]);
+    TEST_CHECK(NULL == jrpc_registry_resolve(&registry, handles[TEST_VALUE_COUNT - 2]));
+    TEST_CHECK(&other == jrpc_registry_resolve(&registry, handle));
+    TEST_CHECK(&other == jrpc_registry_find(&registry, (uint32_t) handle));
+    TEST_CHECK(test_is_active(&registry, &other));
+
+    // removing twice has no effect
+    jrpc_registry_remove(&registry, handle);
+    jrpc_registry_remove(&registry, handle);
+    TEST_CHECK(((TEST_VALUE_COUNT + 2) / 3) == registry.active);
+
+    while (0 < registry.active)
+    {
+        int * value = jrpc_registry_get_active(&registry, 0);
+        jrpc_registry_remove(&registry, handles[value - values]);
+    }
+    TEST_CHECK(NULL == jrpc_registry_get_active(&registry, 0));
+
+    jrpc_registry_cleanup(&registry);
+}
+
+int main(void)
+{
+    test_active_slots();
+
+    return (0 == test_failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,252 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "test_check.h"
+#include "test_client.h"
+
+#include <jrpc/task.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+
+constexpr int test_port = 54324;
+
+std::atomic<bool> is_stopping(false);
+std::atomic<bool> is_hang_started(false);
+std::atomic<bool> is_hang_finished(false);
+std::atomic<bool> has_hang_lost_connection(false);
+
+// server side
+
+jrpc::task<int> answer_later(
+    jrpc_server * server)
+{
+    co_await jrpc::sleep_for(server, std::chrono::milliseconds(20));
+    co_return 42;
+}
+
+jrpc::task<jrpc::json> delay(
+    jrpc::request request,
+    json_t * params,
+    void * user_data)
+{
+    (void) params;
+    (void) user_data;
+
+    int const value = co_await answer_later(request.server());
+    co_return json_integer(value);
+}
+
+jrpc::task<jrpc::json> offload(
+    jrpc::request request,
+    json_t * params,
+    void * user_data)
+{
+    (void) user_data;
+
+    json_int_t const value = json_integer_value(json_array_get(params, 0));
+    json_int_t const result = co_await jrpc::offload(request.server(), [value]() { return value * 2; });
+    co_return json_integer(result);
+}
+
+jrpc::task<jrpc::json> fail(
+    jrpc::request request,
+    json_t * params,
+    void * user_data)
+{
+    (void) request;
+    (void) params;
+    (void) user_data;
+
+    throw jrpc::error(42, "failed");
+    co_return nullptr;
+}
+
+jrpc::task<jrpc::json> fail_offloaded(
+    jrpc::request request,
+    json_t * params,
+    void * user_data)
+{
+    (void) params;
+    (void) user_data;
+
+    co_await jrpc::offload(request.server(), []() { throw jrpc::error(43, "failed offloaded"); });
+    co_return nullptr;
+}
+
+jrpc::task<jrpc::json> hang(
+    jrpc::request request,
+    json_t * params,
+    void * user_data)
+{
+    (void) params;
+    (void) user_data;
+
+    is_hang_started = true;
+    co_await jrpc::sleep_for(request.server(), std::chrono::milliseconds(500));
+    has_hang_lost_connection = ((nullptr == request.connection()) && (request.is_cancelled()));
+    is_hang_finished = true;
+
+    // discarded, since the connection is closed
+    co_return json_string("too late");
+}
+
+// client side
+
+bool is_result(
+    json_t const * message,
+    int id,
+    json_int_t value)
+{
+    json_t * result = json_object_get(message, "result");
+    return ((json_is_integer(result)) && (value == json_integer_value(result)) &&
+        (id == json_integer_value(json_object_get(message, "id"))));
+}
+
+bool is_error(
+    json_t const * message,
+    int id,
+    json_int_t code)
+{
+    json_t * error = json_object_get(message, "error");
+    return ((code == json_integer_value(json_object_get(error, "code"))) &&
+        (id == json_integer_value(json_object_get(message, "id"))));
+}
+
+void call(
+    test_client & client,
+    char const * request)
+{
+    test_client_clear(&client);
+    test_client_send(&client, request);
+    test_client_receive(&client, 1);
+    TEST_CHECK(1 == client.message_count);
+}
+
+void test_methods(
+    test_client & client)
+{
+    call(client, "{\"method\":\"delay\",\"params\":[],\"id\":1}");
+    TEST_CHECK((1 == client.message_count) && (is_result(client.messages[0], 1, 42)));
+
+    call(client, "{\"method\":\"offload\",\"params\":[21],\"id\":2}");
+    TEST_CHECK((1 == client.message_count) && (is_result(client.messages[0], 2, 42)));
+
+    call(client, "{\"method\":\"fail\",\"params\":[],\"id\":3}");
+    TEST_CHECK((1 == client.message_count) && (is_error(client.messages[0], 3, 42)));
+
+    call(client, "{\"method\":\"fail_offloaded\",\"params\":[],\"id\":4}");
+    TEST_CHECK((1 == client.message_count) && (is_error(client.messages[0], 4, 43)));
+
+    // frames are recycled by the pool of the loop's thread
+    for(int i = 0; i < 16; i++)
+    {
+        call(client, "{\"method\":\"delay\",\"params\":[],\"id\":5}");
+        TEST_CHECK((1 == client.message_count) && (is_result(client.messages[0], 5, 42)));
+    }
+
+    test_client_clear(&client);
+}
+
+void test_close_while_suspended()
+{
+    test_client client;
+    bool const is_connected = test_client_connect(&client, test_port);
+    TEST_CHECK(is_connected);
+    if (!is_connected)
+    {
+        test_client_close(&client);
+        return;
+    }
+
+    test_client_send(&client, "{\"method\":\"hang\",\"params\":[],\"id\":1}");
+    for(int i = 0; (i < TEST_CLIENT_TIMEOUT_ITERATIONS) && (!is_hang_started); i++)
+    {
+        lws_service(client.context, 10);
+    }
+    TEST_CHECK(is_hang_started);
+    test_client_close(&client);
+
+    for(int i = 0; (i < TEST_CLIENT_TIMEOUT_ITERATIONS) && (!is_hang_finished); i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    TEST_CHECK(is_hang_finished);
+    TEST_CHECK(has_hang_lost_connection);
+}
+
+void run_clients(
+    jrpc_server * server)
+{
+    test_client client;
+    bool const is_connected = test_client_connect(&client, test_port);
+    TEST_CHECK(is_connected);
+    if (is_connected)
+    {
+        test_methods(client);
+    }
+    test_client_close(&client);
+
+    test_close_while_suspended();
+
+    is_stopping = true;
+    jrpc_server_wakeup(server);
+}
+
+}
+
+int main()
+{
+    jrpc_server * server = jrpc_server_create();
+    jrpc_server_set_port(server, test_port);
+    jrpc_server_set_worker_threads(server, 1);
+    jrpc::register_method<&delay>(server, "delay");
+    jrpc::register_method<&offload>(server, "offload");
+    jrpc::register_method<&fail>(server, "fail");
+    jrpc::register_method<&fail_offloaded>(server, "fail_offloaded");
+    jrpc::register_method<&hang>(server, "hang");
+    if (!jrpc_server_start(server))
+    {
+        TEST_CHECK(false);
+        jrpc_server_dispose(server);
+        return EXIT_FAILURE;
+    }
+
+    std::thread clients(&run_clients, server);
+    while (!is_stopping)
+    {
+        jrpc_server_run(server, 10);
+    }
+    clients.join();
+    jrpc_server_dispose(server);
+
+    return (0 == test_failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
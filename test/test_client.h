@@ -0,0 +1,186 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JRPC_TEST_CLIENT_H
+#define JRPC_TEST_CLIENT_H
+
+#include <libwebsockets.h>
+#include <jansson.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define TEST_CLIENT_MAX_MESSAGES 16
+#define TEST_CLIENT_TIMEOUT_ITERATIONS 500
+
+struct test_client
+{
+    struct lws_context * context;
+    struct lws * wsi;
+    bool is_connected;
+    bool is_failed;
+    char const * pending;
+    char buffer[4096];
+    size_t length;
+    json_t * messages[TEST_CLIENT_MAX_MESSAGES];
+    size_t message_count;
+};
+
+
+static int test_client_callback(
+    struct lws * wsi,
+    enum lws_callback_reasons reason,
+    void * user,
+    void * in,
+    size_t length)
+{
+    (void) user;
+    struct test_client * client = (struct test_client *) lws_context_user(lws_get_context(wsi));
+
+    switch (reason)
+    {
+    case LWS_CALLBACK_CLIENT_ESTABLISHED:
+        client->is_connected = true;
+        break;
+    case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
+        client->is_failed = true;
+        break;
+    case LWS_CALLBACK_CLIENT_RECEIVE:
+        if (client->length + length <= sizeof(client->buffer))
+        {
+            memcpy(&client->buffer[client->length], in, length);
+            client->length += length;
+        }
+
+        if ((lws_is_final_fragment(wsi)) && (client->message_count < TEST_CLIENT_MAX_MESSAGES))
+        {
+            client->messages[client->message_count++] = json_loadb(client->buffer, client->length, 0, NULL);
+            client->length = 0;
+        }
+        break;
+    case LWS_CALLBACK_CLIENT_WRITEABLE:
+        if (NULL != client->pending)
+        {
+            size_t const pending_length = strlen(client->pending);
+            unsigned char * data = (unsigned char *) malloc(LWS_PRE + pending_length);
+            memcpy(&data[LWS_PRE], client->pending, pending_length);
+            lws_write(wsi, &data[LWS_PRE], pending_length, LWS_WRITE_TEXT);
+            free(data);
+            client->pending = NULL;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+static struct lws_protocols test_client_protocols[] =
+{
+    { "jrpc", &test_client_callback, 0, 0, 0, NULL, 0 },
+    { NULL, NULL, 0, 0, 0, NULL, 0 }
+};
+
+static inline bool test_client_connect(
+    struct test_client * client,
+    int port)
+{
+    memset(client, 0, sizeof(struct test_client));
+
+    struct lws_context_creation_info info;
+    memset(&info, 0, sizeof(info));
+    info.port = CONTEXT_PORT_NO_LISTEN;
+    info.protocols = test_client_protocols;
+    info.gid = -1;
+    info.uid = -1;
+    info.user = client;
+    client->context = lws_create_context(&info);
+    if (NULL == client->context)
+    {
+        return false;
+    }
+
+    struct lws_client_connect_info connect_info;
+    memset(&connect_info, 0, sizeof(connect_info));
+    connect_info.context = client->context;
+    connect_info.address = "localhost";
+    connect_info.port = port;
+    connect_info.path = "/";
+    connect_info.host = connect_info.address;
+    connect_info.origin = connect_info.address;
+    connect_info.protocol = test_client_protocols[0].name;
+    connect_info.pwsi = &client->wsi;
+    lws_client_connect_via_info(&connect_info);
+
+    for(size_t i = 0; (i < TEST_CLIENT_TIMEOUT_ITERATIONS) && (!client->is_connected) && (!client->is_failed); i++)
+    {
+        lws_service(client->context, 10);
+    }
+
+    return client->is_connected;
+}
+
+static inline void test_client_send(
+    struct test_client * client,
+    char const * text)
+{
+    client->pending = text;
+    lws_callback_on_writable(client->wsi);
+    for(size_t i = 0; (i < TEST_CLIENT_TIMEOUT_ITERATIONS) && (NULL != client->pending); i++)
+    {
+        lws_service(client->context, 10);
+    }
+}
+
+static inline void test_client_receive(
+    struct test_client * client,
+    size_t count)
+{
+    for(size_t i = 0; (i < TEST_CLIENT_TIMEOUT_ITERATIONS) && (client->message_count < count); i++)
+    {
+        lws_service(client->context, 10);
+    }
+}
+
+static inline void test_client_clear(
+    struct test_client * client)
+{
+    for(size_t i = 0; i < client->message_count; i++)
+    {
+        json_decref(client->messages[i]);
+    }
+    client->message_count = 0;
+}
+
+static inline void test_client_close(
+    struct test_client * client)
+{
+    test_client_clear(client);
+    lws_context_destroy(client->context);
+}
+
+#endif
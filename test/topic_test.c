@@ -0,0 +1,218 @@
+/*
+ * JRPC - Yet another JSON-RPC server based on libwebsockets
+ *  <https://github.com/falk-werner/jrpc>
+ *
+ * Copyright (c) 2019 Falk Werner
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "test_check.h"
+
+#include "jrpc/topic.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_CONNECTION_COUNT 8
+
+struct test_connection
+{
+    struct jrpc_subscriptions subscriptions;
+};
+
+static struct jrpc_connection * test_handle(
+    struct test_connection * connection)
+{
+    // topics never dereference connections
+    return (struct jrpc_connection *) connection;
+}
+
+// every subscriber refers to its subscription and vice versa
+static bool test_is_consistent(
+    struct jrpc_topics const * topics,
+    struct test_connection const * connections,
+    size_t connection_count)
+{
+    size_t subscriber_count = 0;
+    for(size_t i = 0; i < topics->bucket_count; i++)
+    {
+        for(struct jrpc_topic const * topic = topics->buckets[i]; NULL != topic; topic = topic->next)
+        {
+            if (0 == topic->count)
+            {
+                return false;
+            }
+
+            for(size_t j = 0; j < topic->count; j++)
+            {
+                struct jrpc_topic_subscriber const * subscriber = &topic->subscribers[j];
+                struct jrpc_subscription const * subscription = &subscriber->subscriptions->items[subscriber->subscription];
+                if ((topic != subscription->topic) || (j != subscription->subscriber) ||
+                    ((struct jrpc_connection *) subscriber->subscriptions != subscriber->connection))
+                {
+                    return false;
+                }
+            }
+
+            subscriber_count += topic->count;
+        }
+    }
+
+    size_t subscription_count = 0;
+    for(size_t i = 0; i < connection_count; i++)
+    {
+        struct jrpc_subscriptions const * subscriptions = &connections[i].subscriptions;
+        for(size_t j = 0; j < subscriptions->count; j++)
+        {
+            struct jrpc_subscription const * subscription = &subscriptions->items[j];
+            if ((subscription->subscriber >= subscription->topic->count) ||
+                (j != subscription->topic->subscribers[subscription->subscriber].subscription))
+            {
+                return false;
+            }
+        }
+
+        subscription_count += subscriptions->count;
+    }
+
+    return (subscriber_count == subscription_count);
+}
+
+static bool test_is_subscribed(
+    struct jrpc_topics const * topics,
+    struct test_connection * connection,
+    char const * name)
+{
+    struct jrpc_topic const * topic = jrpc_topics_get(topics, name);
+    if (NULL != topic)
+    {
+        for(size_t i = 0; i < topic->count; i++)
+        {
+            if (test_handle(connection) == topic->subscribers[i].connection)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void test_swap_remove(void)
+{
+    struct jrpc_topics topics;
+    struct test_connection connections[TEST_CONNECTION_COUNT];
+    jrpc_topics_init(&topics);
+    for(size_t i = 0; i < TEST_CONNECTION_COUNT; i++)
+    {
+        jrpc_subscriptions_init(&connections[i].subscriptions);
+    }
+
+    char name[16];
+    for(size_t i = 0; i < TEST_CONNECTION_COUNT; i++)
+    {
+        // connection i subscribes to topics 0..i
+        for(size_t j = 0; j <= i; j++)
+        {
+            snprintf(name, sizeof(name), "topic-%zu", j);
+            TEST_CHECK(jrpc_topics_subscribe(&topics, &connections[i].subscriptions, test_handle(&connections[i]), name));
+        }
+    }
+
+    // subscribing twice has no effect
+    TEST_CHECK(jrpc_topics_subscribe(&topics, &connections[3].subscriptions, test_handle(&connections[3]), "topic-0"));
+    TEST_CHECK(TEST_CONNECTION_COUNT == jrpc_topics_get(&topics, "topic-0")->count);
+    TEST_CHECK(test_is_consistent(&topics, connections, TEST_CONNECTION_COUNT));
+
+    // removing the first subscriber of a topic swaps in its last one
+    jrpc_topics_unsubscribe(&topics, &connections[0].subscriptions, "topic-0");
+    TEST_CHECK(!test_is_subscribed(&topics, &connections[0], "topic-0"));
+    TEST_CHECK(test_is_consistent(&topics, connections, TEST_CONNECTION_COUNT));
+
+    // removing the first subscription of a connection swaps in its last one
+    jrpc_topics_unsubscribe(&topics, &connections[5].subscriptions, "topic-0");
+    TEST_CHECK(!test_is_subscribed(&topics, &connections[5], "topic-0"));
+    TEST_CHECK(test_is_subscribed(&topics, &connections[5], "topic-5"));
+    TEST_CHECK(test_is_consistent(&topics, connections, TEST_CONNECTION_COUNT));
+
+    // unsubscribing from an unknown or unsubscribed topic has no effect
+    jrpc_topics_unsubscribe(&topics, &connections[1].subscriptions, "unknown");
+    jrpc_topics_unsubscribe(&topics, &connections[1].subscriptions, "topic-7");
+    TEST_CHECK(test_is_consistent(&topics, connections, TEST_CONNECTION_COUNT));
+
+    // the last subscriber removes the topic
+    TEST_CHECK(NULL != jrpc_topics_get(&topics, "topic-7"));
+    jrpc_topics_unsubscribe(&topics, &connections[7].subscriptions, "topic-7");
+    TEST_CHECK(NULL == jrpc_topics_get(&topics, "topic-7"));
+    TEST_CHECK(test_is_consistent(&topics, connections, TEST_CONNECTION_COUNT));
+
+    for(size_t i = 0; i < TEST_CONNECTION_COUNT; i += 2)
+    {
+        jrpc_topics_unsubscribe_all(&topics, &connections[i].subscriptions);
+        TEST_CHECK(0 == connections[i].subscriptions.count);
+        TEST_CHECK(test_is_consistent(&topics, connections, TEST_CONNECTION_COUNT));
+    }
+
+    for(size_t i = 1; i < TEST_CONNECTION_COUNT; i += 2)
+    {
+        jrpc_topics_unsubscribe_all(&topics, &connections[i].subscriptions);
+    }
+    TEST_CHECK(0 == topics.count);
+
+    jrpc_topics_cleanup(&topics);
+}
+
+static void test_many_topics(void)
+{
+    struct jrpc_topics topics;
+    struct test_connection connection;
+    jrpc_topics_init(&topics);
+    jrpc_subscriptions_init(&connection.subscriptions);
+
+    char name[16];
+    for(size_t i = 0; i < 100; i++)
+    {
+        snprintf(name, sizeof(name), "topic-%zu", i);
+        TEST_CHECK(jrpc_topics_subscribe(&topics, &connection.subscriptions, test_handle(&connection), name));
+    }
+    TEST_CHECK(100 == topics.count);
+    TEST_CHECK(test_is_consistent(&topics, &connection, 1));
+
+    for(size_t i = 0; i < 100; i += 3)
+    {
+        snprintf(name, sizeof(name), "topic-%zu", i);
+        jrpc_topics_unsubscribe(&topics, &connection.subscriptions, name);
+        TEST_CHECK(NULL == jrpc_topics_get(&topics, name));
+    }
+    TEST_CHECK(test_is_consistent(&topics, &connection, 1));
+
+    jrpc_topics_unsubscribe_all(&topics, &connection.subscriptions);
+    TEST_CHECK(0 == topics.count);
+
+    jrpc_topics_cleanup(&topics);
+}
+
+int main(void)
+{
+    test_swap_remove();
+    test_many_topics();
+
+    return (0 == test_failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}